@@ -2,11 +2,20 @@
 #include "main_constants.h"
 #include "radar.h"
 #include "radar_audio.h"
-#include "radar_sphere.h"
+#include "radar_cache.h"
+#include "radar_remap.h"
 #include "radar_object.h"
+#include "radar_profiler.h"
+#include "radar_proximity.h"
+#include "radar_label.h"
+#include "radar_jobs.h"
+#include "radar_metrics.h"
 #include <stdatomic.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
 
-int main(void) {
+int main(int argc, char **argv) {
     SDL_Window* window = NULL;
     SDL_Renderer* renderer = NULL;
 
@@ -45,39 +54,147 @@ int main(void) {
         return 1;
     }
 
-    Radar radar = {
-        .renderer=renderer,
-        .direction=-1, // Multiply by speed to get negative number or positive number, this direction parameter can use to speed up, reverse the rotation or stop the radar line.
-        .angle=0.0,
-        .destination= {0,0,0,0},
-        .padding=0,
-        .radius=RADAR_RADIUS,
-        .with_grid=1,
-        .speed=SWEEP_SPEED,
-        .color = {100, 255, 100, 255},
-        .centerPoint = {10, 10},
-        .sweepLineColor = {255, 255, 255, 255},
-        .grid = {
-            .color = {100, 150, 100, 100},
-            .cellSize = 40,
-            .thinCellNumber = -1
-        },
-        .max_trail_length = 40,
-        .trail_larger = RADAR_RADIUS,
-        .trailColor =  {106, 220, 153, 255},
-        .trail_history_index = 0,
-        .audioData = {0}
-    };
+    // SCOPES: "radar [count]" lays out several scopes side by side, sharing the renderer and the baked layers
+    int scopeCount = argc > 1 ? atoi(argv[1]) : RADAR_SCOPES;
+    if (scopeCount < 1) scopeCount = 1;
+    if (scopeCount > RADAR_MAX_SCOPES) scopeCount = RADAR_MAX_SCOPES;
+
+    int columns = (int) ceil(sqrt(scopeCount));
+    int rows = (scopeCount + columns - 1) / columns;
+    int cellWidth = WINDOW_WIDTH / columns;
+    int cellHeight = WINDOW_HEIGHT / rows;
+    int radius = SDL_min(RADAR_RADIUS, SDL_min(cellWidth, cellHeight) / 2 - RADAR_SCOPE_MARGIN);
+
+    // PROFILER: RADAR_PROFILE=<file.csv|file.json> collects from the start and dumps at exit, F1 toggles the HUD
+    RadarProfiler *profiler = radar_profiler_create();
+    const char *profileDump = getenv("RADAR_PROFILE");
+    if (profileDump != NULL && profiler != NULL) {
+        profiler->enabled = true;
+        profiler->always_enabled = true;
+    }
+
+    // METRICS: RADAR_METRICS=1 (or =/segment-name) publishes live metrics in shared memory for radar_metrics_reader,
+    // the profiler collects from the start to time the frame stages
+    const char *metricsSetting = getenv("RADAR_METRICS");
+    RadarMetrics *metrics = NULL;
+    if (metricsSetting != NULL && strcmp(metricsSetting, "0") != 0) {
+        metrics = radar_metrics_create(metricsSetting[0] == '/' ? metricsSetting : NULL);
+        if (metrics != NULL && profiler != NULL) {
+            profiler->enabled = true;
+            profiler->always_enabled = true;
+        }
+    }
+
+    // BACKEND: batched geometry by default, RADAR_BACKEND=cpu rasterizes on the CPU, RADAR_BACKEND=sdl draws with SDL2_gfx
+    const char *backendName = getenv("RADAR_BACKEND");
+    RadarBackend backend = RADAR_BACKEND_GEOMETRY;
+    if (backendName != NULL && strcmp(backendName, "cpu") == 0) {
+        backend = RADAR_BACKEND_CPU;
+    } else if (backendName != NULL && strcmp(backendName, "sdl") == 0) {
+        backend = RADAR_BACKEND_SDL;
+    }
 
-    radar_init(&radar);
-    radar.destination = radar_rectangle_centered(&radar, CENTER_X, CENTER_Y);
+    // CACHE: RADAR_CACHE=<file> maps the static layers, remap tables and glyph atlases baked by the last run and saves them at exit
+    const char *cacheFile = getenv("RADAR_CACHE");
+    if (cacheFile != NULL && radar_cache_open_file(cacheFile)) {
+        printf("Baked assets mapped from %s\n", cacheFile);
+    }
+
+    // MEMORY: RADAR_HUGE_PAGES=1 backs each radar arena with huge pages when the system provides them
+    const bool hugePages = getenv("RADAR_HUGE_PAGES") != NULL;
+    // ECHO: RADAR_ECHO=1 adds the simulated raw video (noise, sea clutter, contact returns) under the sweep
+    const int withEcho = getenv("RADAR_ECHO") != NULL;
+    // BLOOM: RADAR_BLOOM=1 replaces the layered contact halos with a glow pass over the scope, RADAR_BLOOM=<n> sets the blur levels
+    const char *bloomSetting = getenv("RADAR_BLOOM");
+    const int withBloom = bloomSetting != NULL && strcmp(bloomSetting, "0") != 0;
+    const int bloomLevels = bloomSetting != NULL ? atoi(bloomSetting) : 0;
+    // TERRAIN: RADAR_TERRAIN=<file> masks the contacts hidden by the elevation map and shades the hidden sectors
+    const char *terrainFile = getenv("RADAR_TERRAIN");
+    // LABELS: type, range and bearing of the contacts and ring ranges, RADAR_LABELS=0 hides them, RADAR_FONT=<file.ttf> sets the font
+    const char *labelsSetting = getenv("RADAR_LABELS");
+    const int withLabels = labelsSetting == NULL || strcmp(labelsSetting, "0") != 0;
+    // SWEEP: RADAR_RPM=<turns per minute> sets the scan speed, SWEEP_SPEED degrees per nominal frame otherwise
+    const char *rpmSetting = getenv("RADAR_RPM");
+    const double sweepRate = rpmSetting != NULL ? atof(rpmSetting) * 6.0 : 0.0;
+    // BEAMS: RADAR_SECTOR=<start>,<width> scans the main sweep back and forth over a sector (degrees),
+    // RADAR_BEAMS=<n> adds n beams turning at other rates, the odd ones backwards
+    double sectorStart = 0.0, sectorWidth = 0.0;
+    const char *sectorSetting = getenv("RADAR_SECTOR");
+    if (sectorSetting != NULL && sscanf(sectorSetting, "%lf,%lf", &sectorStart, &sectorWidth) != 2) {
+        sectorWidth = 0.0;
+    }
+    const char *beamsSetting = getenv("RADAR_BEAMS");
+    const int beamCount = beamsSetting != NULL ? SDL_clamp(atoi(beamsSetting), 0, RADAR_MAX_BEAMS) : 0;
+    // TRACKS: RADAR_TRACKS=<n> draws the last n positions of each contact behind it
+    const char *tracksSetting = getenv("RADAR_TRACKS");
+    const int trackLength = tracksSetting != NULL ? atoi(tracksSetting) : 0;
+    // RANGE: RADAR_RANGE_SCALE=<units> sets the world units per scope pixel at zoom 1, +/- zoom, arrows pan, 0 resets the view
+    const char *rangeScaleSetting = getenv("RADAR_RANGE_SCALE");
+    const double rangeScale = rangeScaleSetting != NULL ? atof(rangeScaleSetting) : 0.0;
 
-    // OBJECTS on the radar :
-    radar.radar_objects = radar_object_generate_random_list(&radar);
+    Radar radars[RADAR_MAX_SCOPES];
+    // PROXIMITY: enemy - ally pairs within range of each other are joined by an engagement line
+    RadarProximity *proximities[RADAR_MAX_SCOPES];
+    for (int i = 0; i < scopeCount; ++i) {
+        radars[i] = (Radar){
+            .renderer=renderer,
+            .direction=-1, // Multiply by speed to get negative number or positive number, this direction parameter can use to speed up, reverse the rotation or stop the radar line.
+            .angle=0.0,
+            .destination= {0,0,0,0},
+            .padding=0,
+            .radius=radius,
+            .with_grid=1,
+            .speed=SWEEP_SPEED,
+            .sweep_rate=sweepRate,
+            .sector_start=sectorStart,
+            .sector_width=sectorWidth,
+            .beam_count=beamCount,
+            .track_length=trackLength,
+            .color = {100, 255, 100, 255},
+            .centerPoint = {10, 10},
+            .sweepLineColor = {255, 255, 255, 255},
+            .grid = {
+                .color = {100, 150, 100, 100},
+                .cellSize = 40,
+                .thinCellNumber = -1
+            },
+            .max_trail_length = 40,
+            .trail_larger = radius,
+            .trailColor =  {106, 220, 153, 255},
+            .trail_history_index = 0,
+            .audioData = {0},
+            .profiler = profiler,
+            .backend = backend,
+            .huge_pages = hugePages,
+            .with_echo = withEcho,
+            .terrain_file = terrainFile,
+            .with_bloom = withBloom,
+            .bloomConfig = {.levels = bloomLevels > 1 ? bloomLevels : 0},
+            .with_labels = withLabels,
+            .range_scale = rangeScale
+        };
+
+        for (int b = 0; b < beamCount; ++b) {
+            radars[i].beams[b] = (RadarBeamConfig){
+                .rate = SWEEP_SPEED * RADAR_SWEEP_NOMINAL_FPS * (b + 2) * 0.5 * (b % 2 == 0 ? -1.0 : 1.0),
+                .color = {120, 200, 255, 160}
+            };
+        }
 
-    // AUDIO: Create the new thread (Name the thread, pass the function, pass the user data struct)
-    radar_audio_init(&radar);
-    if (radar.audioData.initialized == 0) {
+        Radar *radar = &radars[i];
+        radar_init(radar);
+        radar->destination = radar_rectangle_centered(radar,
+            cellWidth * (i % columns) + cellWidth / 2,
+            cellHeight * (i / columns) + cellHeight / 2);
+
+        // OBJECTS on the radar :
+        radar->radar_objects = radar_object_generate_random_list(radar, RADAR_CONTACTS);
+        proximities[i] = radar_proximity_create();
+    }
+
+    // AUDIO: only the first scope pings
+    radar_audio_init(&radars[0]);
+    if (radars[0].audioData.initialized == 0) {
         printf("Error initialization");
         return 1;
     }
@@ -93,48 +210,131 @@ int main(void) {
     // }
 
     // Main loop
-    float angle_y = 0.0f;
-    float angle_x = 0.0f;
+    // SPACE stops or restarts the sweep
+    // DISPLAY: v/r cycles PPI, sphere (w/a/s/d rotate), B-scope, sector (a/d turn, w/s widen/narrow)
+    RadarDisplay display = {
+        .mode = RADAR_DISPLAY_PPI,
+        .sectorCenter = -90.0f,
+        .sectorWidth = 60.0f
+    };
     float offset = 10.0f;
-    int mode = 0;
 
     bool running = true;
+    bool redraw = true; // Input or window change since the last frame
     while (running) {
+        // IDLE: when no scope animates and nothing changed, sleep until an input, a redraw request
+        // (radar_request_redraw() from a contact feed or an SDL timer) or the timeout wakes the loop up
+        bool idle = !redraw;
+        for (int i = 0; i < scopeCount && idle; ++i) {
+            idle = !radar_is_animating(&radars[i]);
+        }
+        radar_audio_set_idle(&radars[0], idle);
+
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        int pending = idle ? SDL_WaitEventTimeout(&event, RADAR_IDLE_WAIT_MS) : SDL_PollEvent(&event);
+        for (; pending; pending = SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
-                atomic_store(&radar.audioData.audioThreadRunning, false);
+                atomic_store(&radars[0].audioData.audioThreadRunning, false);
                 running = false;
+            } else if (event.type == radar_redraw_event()) {
+                Radar *radar = event.user.data1;
+                if (radar != NULL) {
+                    radar->needsRedraw = true;
+                } else {
+                    redraw = true;
+                }
+            } else if (event.type == SDL_WINDOWEVENT) {
+                // The last frame may be lost when the window is exposed, resized or restored
+                redraw = true;
             } else if (event.type == SDL_KEYDOWN) {
+                redraw = true;
                 switch (event.key.keysym.sym) {
                     case SDLK_v:
                     case SDLK_r:
-                        mode = mode?0:1;
-                        SDL_DestroyTexture(radar.renderedTexture);
-                        radar.renderedTexture = NULL;
+                        display.mode = (display.mode + 1) % RADAR_DISPLAY_COUNT;
+                        break;
+                    case SDLK_F1:
+                        radar_profiler_toggle_hud(profiler);
+                        break;
+                    case SDLK_SPACE:
+                        // Stop or restart the sweep, a stopped scope with static contacts goes idle
+                        for (int i = 0; i < scopeCount; ++i) {
+                            radars[i].direction = radars[i].direction != 0 ? 0 : -1;
+                        }
                         break;
                     default:
                         break;
                 }
 
-                if (mode) {
-                    if ((event.key.keysym.mod & KMOD_CTRL) != 0) {
-                        offset = 1.0f;
-                    } else {
-                        offset = 10.0f;
+                // View of every scope: zoom by 1.25, pan by a tenth of the visible range
+                for (int i = 0; i < scopeCount; ++i) {
+                    Radar *radar = &radars[i];
+                    const double step = radar->view.range / 10.0;
+                    switch (event.key.keysym.sym) {
+                        case SDLK_PLUS:
+                        case SDLK_EQUALS:
+                        case SDLK_KP_PLUS:
+                            radar_set_view(radar, SDL_min(radar->zoom * 1.25, RADAR_MAX_ZOOM), radar->pan_x, radar->pan_y);
+                            break;
+                        case SDLK_MINUS:
+                        case SDLK_KP_MINUS:
+                            radar_set_view(radar, SDL_max(radar->zoom / 1.25, RADAR_MIN_ZOOM), radar->pan_x, radar->pan_y);
+                            break;
+                        case SDLK_LEFT:
+                            radar_set_view(radar, radar->zoom, radar->pan_x - step, radar->pan_y);
+                            break;
+                        case SDLK_RIGHT:
+                            radar_set_view(radar, radar->zoom, radar->pan_x + step, radar->pan_y);
+                            break;
+                        case SDLK_UP:
+                            radar_set_view(radar, radar->zoom, radar->pan_x, radar->pan_y - step);
+                            break;
+                        case SDLK_DOWN:
+                            radar_set_view(radar, radar->zoom, radar->pan_x, radar->pan_y + step);
+                            break;
+                        case SDLK_0:
+                            radar_set_view(radar, 1.0, 0.0, 0.0);
+                            break;
+                        default:
+                            break;
+                    }
+                }
+
+                if ((event.key.keysym.mod & KMOD_CTRL) != 0) {
+                    offset = 1.0f;
+                } else {
+                    offset = 10.0f;
+                }
+                if (display.mode == RADAR_DISPLAY_SPHERE) {
+                    switch (event.key.keysym.sym) {
+                        case SDLK_w:
+                            display.angle_x += offset;
+                            break;
+                        case SDLK_a:
+                            display.angle_y -= offset;
+                            break;
+                        case SDLK_s:
+                            display.angle_x -= offset;
+                            break;
+                        case SDLK_d:
+                            display.angle_y += offset;
+                            break;
+                        default:
+                            break;
                     }
+                } else if (display.mode == RADAR_DISPLAY_SECTOR) {
                     switch (event.key.keysym.sym) {
                         case SDLK_w:
-                            angle_x += offset;
+                            display.sectorWidth = SDL_min(display.sectorWidth + offset, RADAR_SECTOR_MAX_WIDTH);
                             break;
                         case SDLK_a:
-                            angle_y -= offset;
+                            display.sectorCenter -= offset;
                             break;
                         case SDLK_s:
-                            angle_x -= offset;
+                            display.sectorWidth = SDL_max(display.sectorWidth - offset, RADAR_SECTOR_MIN_WIDTH);
                             break;
                         case SDLK_d:
-                            angle_y += offset;
+                            display.sectorCenter += offset;
                             break;
                         default:
                             break;
@@ -143,24 +343,90 @@ int main(void) {
             }
         }
 
+        if (idle && !redraw) {
+            bool requested = false;
+            for (int i = 0; i < scopeCount && !requested; ++i) {
+                requested = radars[i].needsRedraw;
+            }
+            if (!requested) continue;
+        }
+        redraw = false;
+
+        RADAR_PROFILE_BEGIN(profiler, RADAR_STAGE_FRAME);
         // Clear screen
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
-        radar_initWorkingTexture(&radar);
 
-        radar_object_list_anim_update(&radar);
-        radar_object_list_anim_render(&radar);
+        for (int i = 0; i < scopeCount; ++i) {
+            Radar *radar = &radars[i];
+            radar_initWorkingTexture(radar);
 
-        radar_draw(&radar);
-        if (mode) {
-            render_uv_mapped_sphere(&radar, angle_y, angle_x);
+            RADAR_PROFILE_BEGIN(profiler, RADAR_STAGE_CONTACT_UPDATE);
+            radar_object_list_anim_update(radar);
+            RADAR_PROFILE_END(profiler, RADAR_STAGE_CONTACT_UPDATE);
+
+            RADAR_PROFILE_BEGIN(profiler, RADAR_STAGE_PROXIMITY);
+            if (proximities[i] != NULL) {
+                radar_proximity_update(proximities[i], radar);
+            }
+            RADAR_PROFILE_END(profiler, RADAR_STAGE_PROXIMITY);
+
+            RADAR_PROFILE_BEGIN(profiler, RADAR_STAGE_CONTACT_RENDER);
+            if (proximities[i] != NULL) {
+                radar_proximity_draw(proximities[i], radar, RADAR_ENGAGEMENT_COLOR);
+            }
+            radar_object_list_anim_render(radar);
+            RADAR_PROFILE_END(profiler, RADAR_STAGE_CONTACT_RENDER);
+
+            radar_draw(radar);
+
+            RADAR_PROFILE_BEGIN(profiler, RADAR_STAGE_REMAP);
+            radar_remap_render(radar, &display);
+            RADAR_PROFILE_END(profiler, RADAR_STAGE_REMAP);
         }
-        radar_render(&radar);
-        radar_audio_trigger(&radar);
 
+        RADAR_PROFILE_BEGIN(profiler, RADAR_STAGE_RENDER);
+        radar_render_all(radars, scopeCount);
+        RADAR_PROFILE_END(profiler, RADAR_STAGE_RENDER);
+
+        // Labels follow the contacts of the PPI only
+        RADAR_PROFILE_BEGIN(profiler, RADAR_STAGE_LABELS);
+        if (display.mode == RADAR_DISPLAY_PPI) {
+            for (int i = 0; i < scopeCount; ++i) {
+                radar_labels_draw(&radars[i]);
+            }
+        }
+        RADAR_PROFILE_END(profiler, RADAR_STAGE_LABELS);
+
+        for (int i = 0; i < scopeCount; ++i) {
+            radar_audio_trigger(&radars[i]);
+        }
+
+        radar_profiler_render_hud(profiler, renderer, 10, 10);
 
         // Present render
+        RADAR_PROFILE_BEGIN(profiler, RADAR_STAGE_PRESENT);
         SDL_RenderPresent(renderer);
+        RADAR_PROFILE_END(profiler, RADAR_STAGE_PRESENT);
+        RADAR_PROFILE_END(profiler, RADAR_STAGE_FRAME);
+
+        if (metrics != NULL) {
+            Uint32 contacts = 0;
+            for (int i = 0; i < scopeCount; ++i) {
+                contacts += radars[i].contactPool.used;
+            }
+            RadarMetricsData *data = radar_metrics_begin(metrics);
+            data->frame++;
+            data->timeMs = SDL_GetTicks64();
+            data->frameUs = (Uint32) (radar_profiler_last_frame_ms(profiler, RADAR_STAGE_FRAME) * 1000.0);
+            data->trailUs = (Uint32) (radar_profiler_last_frame_ms(profiler, RADAR_STAGE_TRAIL) * 1000.0);
+            data->sphereUs = (Uint32) (radar_profiler_last_frame_ms(profiler, RADAR_STAGE_REMAP) * 1000.0);
+            data->contacts = contacts;
+            data->scopes = scopeCount;
+            data->audioUnderruns = radars[0].audioData.userData.underruns;
+            data->idle = idle;
+            radar_metrics_end(metrics);
+        }
 
         // Add small delay to control frame rate
         SDL_Delay(5);  // Approximately 60 FPS
@@ -169,8 +435,26 @@ int main(void) {
     // Cleanup
     // No Audio Thread
     // SDL_WaitThread(radarAudioThread, NULL);
-    radar_audio_cleanup(&radar);
-    radar_cleanup(&radar);
+    if (profileDump != NULL && profiler != NULL && profiler->timers[RADAR_STAGE_FRAME].calls > 0) {
+        radar_profiler_dump(profiler, profileDump);
+    }
+
+    if (cacheFile != NULL) {
+        radar_cache_save_file();
+    }
+    radar_audio_cleanup(&radars[0]);
+    for (int i = 0; i < scopeCount; ++i) {
+        RadarMemoryUsage memory = radar_memory_usage(&radars[i]);
+        printf("Radar %d memory: %zu bytes in arena (%zu reserved), %zu in buffers, %zu shared\n",
+            i, memory.arenaUsed, memory.arenaReserved, memory.buffers, memory.shared);
+        radars[i].profiler = NULL;
+        radar_cleanup(&radars[i]);
+        radar_proximity_destroy(proximities[i]);
+    }
+    radar_cache_close_file();
+    radar_metrics_close(metrics);
+    radar_profiler_destroy(profiler);
+    radar_jobs_shutdown();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
@@ -6,6 +6,12 @@
 #define CENTER_X (WINDOW_WIDTH / 2)
 #define CENTER_Y (WINDOW_HEIGHT / 2)
 #define RADAR_RADIUS 400
-#define SWEEP_SPEED 2.0  // Degrees per frame
+#define SWEEP_SPEED 2.0  // Degrees per frame at RADAR_SWEEP_NOMINAL_FPS
+#define RADAR_CONTACTS 10
+#define RADAR_SCOPES 1 // Default number of scopes, the first program argument overrides it
+#define RADAR_MAX_SCOPES 16
+#define RADAR_SCOPE_MARGIN 10
+#define RADAR_ENGAGEMENT_COLOR ((SDL_Color){255, 60, 60, 160})
+#define RADAR_IDLE_WAIT_MS 1000 // Longest sleep of an idle main loop between two checks
 
 #endif
@@ -1,23 +1,129 @@
 #include "radar.h"
-#include <SDL2_gfxPrimitives.h>
+#include "radar_profiler.h"
+#include "radar_cache.h"
+#include "radar_primitive.h"
+#include "radar_raster.h"
+#include "radar_batch.h"
+#include "radar_arena.h"
+#include "radar_echo.h"
+#include "radar_bloom.h"
+#include "radar_terrain.h"
+#include "radar_beam.h"
+#include "radar_track.h"
+#include "radar_label.h"
+#include "radar_object.h"
 #include <SDL2/SDL.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+// Center in scope coordinates, used for the static layer and the trail history
 #define RADAR_CENTER(radar) (radar->padding + radar->radius)
 
+/**
+ * The per radar buffers (trail history, contact pool, scope pixels, echo video, bloom levels, terrain horizon, contact tracks) are carved from one arena
+ * sized here: a single allocation, contiguous data, and a single release in radar_cleanup().
+ */
 void radar_init(Radar *radar) {
-    radar->trail_history = (RadarTrailPoint**) malloc(sizeof(RadarTrailPoint*) * radar->trail_larger);
-    for (size_t i = radar->max_trail_length-1; i > 0; --i) {
-        for (size_t n = 0; n < radar->trail_larger; ++n) {
-            radar->trail_history[n] = (RadarTrailPoint*) malloc(sizeof(RadarTrailPoint) * radar->max_trail_length);
-            radar->trail_history[n][i] = (RadarTrailPoint){0,0};
+    radar_redraw_event(); // Registered from the main thread, before any feed thread can request a redraw
+    radar->needsRedraw = true;
+    radar->settleSamples = radar->max_trail_length;
+    if (radar->max_contacts <= 0) {
+        radar->max_contacts = RADAR_DEFAULT_MAX_CONTACTS;
+    }
+    if (radar->range_scale <= 0.0) {
+        radar->range_scale = 1.0;
+    }
+    if (radar->theater_range <= 0.0) {
+        // Everything the view can show fully zoomed out, so zooming out finds the contacts still there
+        radar->theater_range = radar->radius * radar->range_scale / RADAR_MIN_ZOOM;
+    }
+    radar_set_view(radar, radar->zoom, radar->pan_x, radar->pan_y);
+    const size_t trailRows = sizeof(RadarTrailPoint*) * radar->trail_larger;
+    const size_t trailPoints = sizeof(RadarTrailPoint) * radar->trail_larger * radar->max_trail_length;
+    const size_t contacts = sizeof(RadarObjectLinkedList) * radar->max_contacts;
+    const size_t pixels = sizeof(Uint32) * radar_width(radar) * radar_height(radar);
+    const size_t echo = radar->with_echo ? radar_echo_footprint(radar) : 0;
+    const size_t bloom = radar->with_bloom ? radar_bloom_footprint(radar) : 0;
+    const size_t terrain = radar->terrain_file != NULL ? radar_terrain_footprint(radar) : 0;
+    const size_t beams = radar_beam_view_footprint(radar);
+    const size_t tracks = radar->track_length > 0 ? radar_tracks_footprint(radar) : 0;
+    radar->arena = radar_arena_create(
+        RADAR_ARENA_FOOTPRINT(trailRows) + RADAR_ARENA_FOOTPRINT(trailPoints) +
+        RADAR_ARENA_FOOTPRINT(contacts) + RADAR_ARENA_FOOTPRINT(pixels) + echo + bloom + terrain + beams + tracks,
+        radar->huge_pages);
+    if (radar->arena == NULL) {
+        fprintf(stderr, "Could not allocate the radar memory\n");
+        return;
+    }
+
+    // Trail: one row of max_trail_length points per pixel of the trail width, zeroed (no history yet)
+    radar->trail_history = radar_arena_alloc(radar->arena, trailRows);
+    RadarTrailPoint *trailPoint = radar_arena_alloc(radar->arena, trailPoints);
+    for (int n = 0; n < radar->trail_larger; ++n) {
+        radar->trail_history[n] = trailPoint + (size_t) n * radar->max_trail_length;
+    }
+
+    radar_object_pool_init(&radar->contactPool, radar_arena_alloc(radar->arena, contacts), radar->max_contacts);
+
+    // Scope pixels: the CPU raster target, or the read back buffer of the display remap
+    Uint32 *scopePixels = radar_arena_alloc(radar->arena, pixels);
+    if (radar->backend != RADAR_BACKEND_CPU) {
+        radar->remapPixels = scopePixels;
+    }
+
+    if (radar->with_echo) {
+        radar->echo = radar_echo_create(radar, radar->arena);
+    }
+
+    if (radar->with_bloom) {
+        radar->bloom = radar_bloom_create(radar, radar->arena);
+    }
+
+    if (radar->terrain_file != NULL) {
+        radar->terrain = radar_terrain_create(radar, radar->arena, radar->terrain_file);
+    }
+
+    radar->beamView = radar_beam_view_create(radar, radar->arena);
+    radar_beams_init(radar);
+
+    if (radar->with_labels) {
+        radar->labels = radar_labels_create(radar);
+    }
+
+    if (radar->backend == RADAR_BACKEND_CPU && radar->raster == NULL) {
+        radar->raster = radar_raster_create(radar_width(radar), radar_height(radar), scopePixels);
+        if (radar->raster == NULL) {
+            fprintf(stderr, "Could not create the CPU raster, falling back to SDL drawing\n");
+            radar->backend = RADAR_BACKEND_SDL;
+            radar->remapPixels = scopePixels; // The display remap and the bloom now read the scope back
         }
     }
+    if (radar->backend == RADAR_BACKEND_GEOMETRY && radar->batch == NULL) {
+        radar->batch = radar_batch_create();
+        if (radar->batch == NULL) {
+            radar->backend = RADAR_BACKEND_SDL;
+        }
+    }
+
+    // Once the backend is settled: the tails of the SDL one need a batch of their own
+    if (radar->track_length > 0) {
+        radar->tracks = radar_tracks_create(radar, radar->arena);
+    }
+}
+
+/**
+ * CPU backend: send the rasterized scope to the working texture, skipped when a display
+ * remap already sampled the raster directly.
+ */
+static void radar_upload_raster(Radar *radar) {
+    if (radar->backend != RADAR_BACKEND_CPU || radar->renderedTexture != NULL || radar->workingTexture == NULL) return;
+    SDL_UpdateTexture(radar->workingTexture, NULL, radar->raster->ownedPixels, radar->raster->ownedWidth * (int) sizeof(Uint32));
 }
 
 void radar_render(Radar *radar) {
+    radar_upload_raster(radar);
     SDL_SetRenderTarget(radar->renderer, NULL);
     if (radar->renderedTexture != NULL) {
         SDL_RenderCopy(radar->renderer, radar->renderedTexture, NULL, &radar->destination);
@@ -26,55 +132,364 @@ void radar_render(Radar *radar) {
     }
 }
 
+/**
+ * Copy every scope to the screen in one pass, once all of them are drawn in their working texture.
+ * Scopes sharing the same renderer only switch the render target once per frame.
+ */
+void radar_render_all(Radar *radars, int count) {
+    SDL_Renderer *currentRenderer = NULL;
+    for (int i = 0; i < count; ++i) {
+        Radar *radar = &radars[i];
+        radar_upload_raster(radar);
+        if (radar->renderer != currentRenderer) {
+            currentRenderer = radar->renderer;
+            SDL_SetRenderTarget(currentRenderer, NULL);
+        }
+        SDL_RenderCopy(currentRenderer,
+            radar->renderedTexture != NULL ? radar->renderedTexture : radar->workingTexture,
+            NULL, &radar->destination);
+    }
+}
+
 void radar_initWorkingTexture(Radar *radar) {
     if (radar->workingTexture == NULL) {
         radar->workingTexture = SDL_CreateTexture(
             radar->renderer,
-            SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+            SDL_PIXELFORMAT_RGBA8888,
+            radar->backend == RADAR_BACKEND_CPU ? SDL_TEXTUREACCESS_STREAMING : SDL_TEXTUREACCESS_TARGET,
             radar_width(radar), radar_height(radar)
         );
+        if (radar->backend == RADAR_BACKEND_CPU) {
+            SDL_SetTextureBlendMode(radar->workingTexture, SDL_BLENDMODE_BLEND);
+        }
     }
 
+    if (radar->backend == RADAR_BACKEND_CPU) {
+        radar_raster_clear(radar->raster, 0);
+        return;
+    }
     SDL_SetRenderTarget(radar->renderer, radar->workingTexture);
     SDL_RenderClear(radar->renderer);
 }
 
-void radar_draw(Radar *radar) {
+/**
+ * Shadow of the sectors masked by the terrain, under the grid and circles; NULL without terrain
+ */
+static Uint32* radar_terrain_shadow_pixels(const Radar *radar) {
+    if (radar->terrain == NULL) return NULL;
+    Uint32 *shadow = malloc(sizeof(Uint32) * radar_width(radar) * radar_height(radar));
+    if (shadow != NULL) {
+        radar_terrain_shadow(radar, shadow);
+    }
+    return shadow;
+}
+
+/**
+ * CPU backend: grid and circles rasterized once in a shared RGBA8888 buffer.
+ * Primitives already recorded are flushed first so the order with the layer is kept.
+ */
+static void radar_bake_static_pixels(Radar *radar) {
+    const int width = radar_width(radar);
+    const int height = radar_height(radar);
+    Uint32 *pixels = calloc((size_t) width * height, sizeof(Uint32));
+    if (pixels == NULL) return;
+
+    RadarRaster *raster = radar->raster;
+    RadarRaster binding = *raster;
+    radar_raster_flush(raster);
+    radar_raster_bind(raster, pixels, width, height, width, NULL);
+
+    Uint32 *shadow = radar_terrain_shadow_pixels(radar);
+    if (shadow != NULL) {
+        radar_raster_layer(raster, shadow, 0, 0, width, height);
+        radar_raster_flush(raster);
+        free(shadow);
+    }
+
+    if (radar->with_grid) {
+        RADAR_PROFILE_BEGIN(radar->profiler, RADAR_STAGE_GRID);
+        radar_draw_bkg_grid(radar);
+        RADAR_PROFILE_END(radar->profiler, RADAR_STAGE_GRID);
+    }
+    RADAR_PROFILE_BEGIN(radar->profiler, RADAR_STAGE_CIRCLES);
+    radar_draw_circles(radar);
+    radar_raster_flush(raster);
+    RADAR_PROFILE_END(radar->profiler, RADAR_STAGE_CIRCLES);
+
+    radar_raster_bind(raster, binding.pixels, binding.width, binding.height, binding.pitch, &binding.clip);
+    radar->staticLayer->data = pixels;
+    radar->staticLayer->dataSize = sizeof(Uint32) * width * height;
+}
+
+/**
+ * GPU backends: grid and circles drawn once in a shared target texture.
+ * A pending geometry batch belongs to the current target and is flushed before switching.
+ */
+static void radar_bake_static_texture(Radar *radar) {
+    radar_primitive_flush(radar);
+    SDL_Texture *target = SDL_GetRenderTarget(radar->renderer);
+    SDL_Rect clip;
+    SDL_RenderGetClipRect(radar->renderer, &clip);
+    SDL_Texture *layer = SDL_CreateTexture(
+        radar->renderer,
+        SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+        radar_width(radar), radar_height(radar)
+    );
+    if (layer == NULL) {
+        fprintf(stderr, "Could not create static layer: %s\n", SDL_GetError());
+        return;
+    }
+    SDL_SetTextureBlendMode(layer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderTarget(radar->renderer, layer);
+    SDL_SetRenderDrawColor(radar->renderer, 0, 0, 0, 0);
+    SDL_RenderClear(radar->renderer);
+
+    Uint32 *shadow = radar_terrain_shadow_pixels(radar);
+    if (shadow != NULL) {
+        SDL_Texture *shadowTexture = SDL_CreateTexture(radar->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC,
+                                                       radar_width(radar), radar_height(radar));
+        if (shadowTexture != NULL) {
+            SDL_UpdateTexture(shadowTexture, NULL, shadow, radar_width(radar) * (int) sizeof(Uint32));
+            SDL_SetTextureBlendMode(shadowTexture, SDL_BLENDMODE_BLEND);
+            SDL_RenderCopy(radar->renderer, shadowTexture, NULL, NULL);
+            SDL_DestroyTexture(shadowTexture);
+        }
+        free(shadow);
+    }
 
     if (radar->with_grid) {
+        RADAR_PROFILE_BEGIN(radar->profiler, RADAR_STAGE_GRID);
         radar_draw_bkg_grid(radar);
+        RADAR_PROFILE_END(radar->profiler, RADAR_STAGE_GRID);
     }
+    RADAR_PROFILE_BEGIN(radar->profiler, RADAR_STAGE_CIRCLES);
     radar_draw_circles(radar);
+    radar_primitive_flush(radar);
+    RADAR_PROFILE_END(radar->profiler, RADAR_STAGE_CIRCLES);
+
+    radar->staticLayer->texture = layer;
+    SDL_SetRenderTarget(radar->renderer, target);
+    SDL_RenderSetClipRect(radar->renderer, SDL_RectEmpty(&clip) ? NULL : &clip);
+}
+
+/**
+ * Grid, circles and terrain shadow only depend on the radar parameters: they are drawn once in a texture (or a
+ * pixel buffer with the CPU backend) shared by every radar with the same parameters and copied on each frame.
+ */
+void radar_draw_static_layer(Radar *radar) {
+    const bool cpu = radar->backend == RADAR_BACKEND_CPU;
+    const RadarCacheKind kind = cpu ? RADAR_CACHE_STATIC_PIXELS : RADAR_CACHE_STATIC_LAYER;
+    SDL_Renderer *owner = cpu ? NULL : radar->renderer;
+
+    if (radar->staticLayer != NULL && (radar->staticLayer->kind != kind || radar->staticLayer->renderer != owner)) {
+        radar_cache_release(radar->staticLayer);
+        radar->staticLayer = NULL;
+    }
+    if (radar->staticLayer == NULL) {
+        struct {
+            int radius, padding, with_grid;
+            SDL_Color color;
+            RadarGrid grid;
+            Uint32 terrain;
+            float zoom, panX, panY; // Only with terrain, the rest of the layer does not move with the view
+        } key;
+        memset(&key, 0, sizeof(key));
+        key.radius = radar->radius;
+        key.padding = radar->padding;
+        key.with_grid = radar->with_grid;
+        key.color = radar->color;
+        key.grid = radar->grid;
+        if (radar->terrain != NULL) {
+            key.terrain = radar->terrain->hash;
+            key.zoom = (float) radar->zoom;
+            key.panX = (float) radar->pan_x;
+            key.panY = (float) radar->pan_y;
+        }
+        radar->staticLayer = radar_cache_acquire(kind, owner, &key, sizeof(key));
+        if (radar->staticLayer == NULL) return;
+        // A layer from the cache file must have the size of the scope, it is dropped and baked below otherwise
+        RadarCacheEntry *entry = radar->staticLayer;
+        if (cpu) {
+            radar_cache_has_data(entry, sizeof(Uint32) * radar_width(radar) * radar_height(radar));
+        } else if (entry->mapped && (entry->pixelWidth != radar_width(radar) || entry->pixelHeight != radar_height(radar))) {
+            radar_cache_drop_mapped(entry);
+        }
+    }
+
+    if (cpu) {
+        if (radar->staticLayer->data == NULL) {
+            radar_bake_static_pixels(radar);
+            if (radar->staticLayer->data == NULL) return;
+        }
+        radar_raster_layer(radar->raster, radar->staticLayer->data,
+            radar->origin.x, radar->origin.y, radar_width(radar), radar_height(radar));
+        return;
+    }
+
+    if (radar->staticLayer->texture == NULL && radar_cache_texture(radar->staticLayer) != NULL) {
+        SDL_SetTextureBlendMode(radar->staticLayer->texture, SDL_BLENDMODE_BLEND);
+    }
+    if (radar->staticLayer->texture == NULL) {
+        radar_bake_static_texture(radar);
+        if (radar->staticLayer->texture == NULL) return;
+    }
+    SDL_Rect destination = radar_rectangle(radar, radar->origin.x, radar->origin.y);
+    radar_primitive_flush(radar); // Keep batched contacts under the layer
+    SDL_RenderCopy(radar->renderer, radar->staticLayer->texture, NULL, &destination);
+}
+
+void radar_draw(Radar *radar) {
+    radar_sweep_update(radar);
+    radar_beams_detect(radar);
+
+    RADAR_PROFILE_BEGIN(radar->profiler, RADAR_STAGE_STATIC_LAYER);
+    radar_draw_static_layer(radar);
+    RADAR_PROFILE_END(radar->profiler, RADAR_STAGE_STATIC_LAYER);
+
+    RADAR_PROFILE_BEGIN(radar->profiler, RADAR_STAGE_ECHO);
+    radar_echo_update(radar);
+    radar_echo_draw(radar);
+    RADAR_PROFILE_END(radar->profiler, RADAR_STAGE_ECHO);
+
+    RADAR_PROFILE_BEGIN(radar->profiler, RADAR_STAGE_SWEEP_LINE);
     radar_draw_sweep_line(radar);
+    RADAR_PROFILE_END(radar->profiler, RADAR_STAGE_SWEEP_LINE);
+
+    RADAR_PROFILE_BEGIN(radar->profiler, RADAR_STAGE_TRAIL);
     update_radar_trail(radar);
+    RADAR_PROFILE_END(radar->profiler, RADAR_STAGE_TRAIL);
     radar_draw_middle_point(radar);
 
-    // Update angle
-    radar->angle += radar->speed*radar->direction;
-    if (radar->angle >= 360.0) {
-        radar->angle = 0.0;
+    radar_primitive_flush(radar);
+
+    RADAR_PROFILE_BEGIN(radar->profiler, RADAR_STAGE_BLOOM);
+    radar_bloom_apply(radar);
+    RADAR_PROFILE_END(radar->profiler, RADAR_STAGE_BLOOM);
+
+    radar->needsRedraw = false;
+}
+
+/**
+ * Draw the scope straight into a render target of the radar renderer (NULL for the window),
+ * with its top left corner at (x, y). Nothing goes through the working texture.
+ * Contacts are drawn but not animated: radar_object_list_anim_update() stays with the caller.
+ * Display remaps (sphere, B-scope, sector) need the working texture and is not available in this mode.
+ */
+void radar_draw_into(Radar *radar, SDL_Texture *target, int x, int y) {
+    SDL_Rect clip = radar_rectangle(radar, x, y);
+
+    if (radar->backend == RADAR_BACKEND_CPU) {
+        // The raster is not attached to the renderer: rasterize, upload once and copy
+        radar_initWorkingTexture(radar);
+        radar_object_list_anim_render(radar);
+        radar_draw(radar);
+        radar_upload_raster(radar);
+        SDL_SetRenderTarget(radar->renderer, target);
+        SDL_RenderCopy(radar->renderer, radar->workingTexture, NULL, &clip);
+        return;
     }
 
-    SDL_SetRenderTarget(radar->renderer, NULL);
+    SDL_SetRenderTarget(radar->renderer, target);
+    SDL_RenderSetClipRect(radar->renderer, &clip);
+    radar->origin = (SDL_Point){x, y};
+
+    radar_object_list_anim_render(radar);
+    radar_draw(radar);
+
+    radar->origin = (SDL_Point){0, 0};
+    SDL_RenderSetClipRect(radar->renderer, NULL);
+}
+
+/**
+ * Draw the scope in place into a caller owned pixel buffer (e.g. a locked streaming texture or a
+ * surface of a dashboard), with its top left corner at (x, y).
+ * The buffer is wrapped, never copied; the software renderer on top of it is kept between frames
+ * as long as the buffer does not change.
+ */
+void radar_draw_into_pixels(Radar *radar, void *pixels, int pitch, int width, int height, Uint32 format, int x, int y) {
+    if (radar->backend == RADAR_BACKEND_CPU && format == SDL_PIXELFORMAT_RGBA8888 && pitch % sizeof(Uint32) == 0) {
+        // Rasterize straight into the caller buffer
+        SDL_Rect clip = radar_rectangle(radar, x, y);
+        radar_raster_bind(radar->raster, pixels, width, height, pitch / (int) sizeof(Uint32), &clip);
+        radar->origin = (SDL_Point){x, y};
+        radar_object_list_anim_render(radar);
+        radar_draw(radar);
+        radar->origin = (SDL_Point){0, 0};
+        radar_raster_unbind(radar->raster);
+        return;
+    }
+
+    RadarPixelTarget *pixelTarget = &radar->pixelTarget;
+    if (pixelTarget->surface == NULL ||
+        pixelTarget->surface->pixels != pixels || pixelTarget->surface->pitch != pitch ||
+        pixelTarget->surface->w != width || pixelTarget->surface->h != height ||
+        pixelTarget->surface->format->format != format) {
+        radar_release_pixel_target(radar);
+
+        pixelTarget->surface = SDL_CreateRGBSurfaceWithFormatFrom(pixels, width, height, 32, pitch, format);
+        if (pixelTarget->surface == NULL) {
+            fprintf(stderr, "Could not wrap pixel buffer: %s\n", SDL_GetError());
+            return;
+        }
+        pixelTarget->renderer = SDL_CreateSoftwareRenderer(pixelTarget->surface);
+        if (pixelTarget->renderer == NULL) {
+            fprintf(stderr, "Could not create software renderer: %s\n", SDL_GetError());
+            radar_release_pixel_target(radar);
+            return;
+        }
+        SDL_SetRenderDrawBlendMode(pixelTarget->renderer, SDL_BLENDMODE_BLEND);
+    }
+
+    SDL_Renderer *renderer = radar->renderer;
+    radar->renderer = pixelTarget->renderer;
+    radar_draw_into(radar, NULL, x, y);
+    radar->renderer = renderer;
+}
+
+void radar_release_pixel_target(Radar *radar) {
+    RadarPixelTarget *pixelTarget = &radar->pixelTarget;
+    if (radar->staticLayer != NULL && pixelTarget->renderer != NULL && radar->staticLayer->renderer == pixelTarget->renderer) {
+        radar_cache_release(radar->staticLayer);
+        radar->staticLayer = NULL;
+    }
+    if (pixelTarget->renderer != NULL) {
+        SDL_DestroyRenderer(pixelTarget->renderer);
+        pixelTarget->renderer = NULL;
+    }
+    if (pixelTarget->surface != NULL) {
+        SDL_FreeSurface(pixelTarget->surface);
+        pixelTarget->surface = NULL;
+    }
 }
 
 void radar_draw_middle_point(Radar *radar) {
     // Draw middle circle
     RadarCenterPoint* cpz = &radar->centerPoint;
-    roundedBoxRGBA(radar->renderer,
-        RADAR_CENTER(radar)-cpz->radius,RADAR_CENTER(radar)-cpz->radius,
-        RADAR_CENTER(radar)+cpz->radius, RADAR_CENTER(radar)+cpz->radius,
-        cpz->corner, radar->sweepLineColor.r, radar->sweepLineColor.g, radar->sweepLineColor.b, radar->sweepLineColor.a);
+    radar_primitive_rounded_box(radar,
+        RADAR_CENTER_X(radar)-cpz->radius,RADAR_CENTER_Y(radar)-cpz->radius,
+        RADAR_CENTER_X(radar)+cpz->radius, RADAR_CENTER_Y(radar)+cpz->radius,
+        cpz->corner, radar->sweepLineColor);
 }
 
 void radar_draw_sweep_line(Radar *radar) {
     // Draw a sweep line
     double rad = radar->angle * M_PI / 180.0f;
-    thickLineRGBA(radar->renderer,
-                      RADAR_CENTER(radar),RADAR_CENTER(radar),
-                      RADAR_CENTER(radar) + radar->radius * cos(rad),
-                      RADAR_CENTER(radar) + radar->radius * sin(rad),
-                      5, radar->sweepLineColor.r, radar->sweepLineColor.g, radar->sweepLineColor.b, radar->sweepLineColor.a);
+    radar_primitive_line(radar,
+                      RADAR_CENTER_X(radar),RADAR_CENTER_Y(radar),
+                      RADAR_CENTER_X(radar) + radar->radius * cos(rad),
+                      RADAR_CENTER_Y(radar) + radar->radius * sin(rad),
+                      5, radar->sweepLineColor);
+
+    // Extra beams, thinner
+    for (int i = 0; i < radar->beam_count; ++i) {
+        const double beamRad = radar->beamState[i].angle * M_PI / 180.0;
+        const SDL_Color color = radar->beams[i].color.a != 0 ? radar->beams[i].color : radar->sweepLineColor;
+        radar_primitive_line(radar,
+                          RADAR_CENTER_X(radar), RADAR_CENTER_Y(radar),
+                          RADAR_CENTER_X(radar) + radar->radius * cos(beamRad),
+                          RADAR_CENTER_Y(radar) + radar->radius * sin(beamRad),
+                          3, color);
+    }
 
     // rad -= 0.05;
     // thickLineRGBA(radar->renderer,
@@ -85,49 +500,77 @@ void radar_draw_sweep_line(Radar *radar) {
 }
 
 void update_radar_trail(Radar* radar) {
-    for (size_t i = radar->max_trail_length-1; i > 0; --i) {
+    if (radar->trail_history == NULL) return;
+    // One sample every RADAR_SWEEP_TRAIL_STEP degrees along the path of the sweep, whatever the frame rate:
+    // the travel short of the next sample is carried over to the next frame
+    radar->trailCarry += radar->sweep.travel;
+    const double heading = radar->trailCarry < 0.0 ? -1.0 : 1.0;
+    int samples = (int) (fabs(radar->trailCarry) / RADAR_SWEEP_TRAIL_STEP);
+    double behind = fabs(radar->trailCarry) - samples * RADAR_SWEEP_TRAIL_STEP; // From the newest sample to the sweep
+    double step = RADAR_SWEEP_TRAIL_STEP;
+    radar->trailCarry = heading * behind;
+
+    if (radar->sweep.span != 0.0) {
+        radar->settleSamples = radar->max_trail_length;
+        radar->trailIdle = 0.0;
+    } else if (radar->settleSamples > 0) {
+        // Stopped: the trail comes to rest by elapsed time, one sample at the sweep per nominal frame
+        radar->trailIdle += radar->sweepElapsed;
+        samples = SDL_min((int) (radar->trailIdle * RADAR_SWEEP_NOMINAL_FPS), radar->settleSamples);
+        radar->trailIdle -= (double) samples / RADAR_SWEEP_NOMINAL_FPS;
+        radar->settleSamples -= samples;
+        behind = 0.0;
+        step = 0.0;
+    }
+
+    samples = SDL_min(samples, radar->max_trail_length);
+    const size_t kept = (size_t) (radar->max_trail_length - samples);
+    for (size_t n = 0; n < radar->trail_larger && samples > 0; ++n) {
+        memmove(radar->trail_history[n] + samples, radar->trail_history[n], sizeof(RadarTrailPoint) * kept);
+    }
+    for (int s = 0; s < samples; ++s) {
+        // Newest first, back along the path of the sweep
+        const double rad = (radar->angle - heading * (behind + s * step)) * M_PI / 180.0;
+        const double c = cos(rad);
+        const double d = sin(rad);
         for (size_t n = 0; n < radar->trail_larger; ++n) {
-            radar->trail_history[n][i] = radar->trail_history[n][i-1];
+            radar->trail_history[n][s].x = RADAR_CENTER(radar) + c * (radar->radius-n);
+            radar->trail_history[n][s].y = RADAR_CENTER(radar) + d * (radar->radius-n);
         }
     }
 
-    double rad = radar->angle * M_PI / 180.0f;
     for (size_t n = 0; n < radar->trail_larger; ++n) {
-
-        radar->trail_history[n][0].x = RADAR_CENTER(radar) + cos(rad) * (radar->radius-n);
-        radar->trail_history[n][0].y = RADAR_CENTER(radar) + sin(rad) * (radar->radius-n);
-
         for (size_t i = 0; i+1 < (radar->max_trail_length-1); ++i) {
 
             if (radar->trail_history[n][i+1].x == 0 || radar->trail_history[n][i+1].y == 0) {
                 break;
             }
 
-            Uint8 alpha = (Uint8)(255.0f * (radar->max_trail_length - i) / radar->max_trail_length);
+            SDL_Color color = radar->trailColor;
+            color.a = (Uint8)(255.0f * (radar->max_trail_length - i) / radar->max_trail_length);
 
-            thickLineRGBA(radar->renderer,
-            radar->trail_history[n][i].x,
-            radar->trail_history[n][i].y,
-            radar->trail_history[n][i+1].x,
-            radar->trail_history[n][i+1].y,
-            1, radar->trailColor.r, radar->trailColor.g, radar->trailColor.b, alpha);
+            radar_primitive_line(radar,
+            radar->origin.x + radar->trail_history[n][i].x,
+            radar->origin.y + radar->trail_history[n][i].y,
+            radar->origin.x + radar->trail_history[n][i+1].x,
+            radar->origin.y + radar->trail_history[n][i+1].y,
+            1, color);
         }
     }
 }
 
 void radar_draw_circles(const Radar *radar) {
-    SDL_SetRenderDrawColor(radar->renderer, radar->color.r, radar->color.g, radar->color.b, radar->color.a);
     int count=0;
     for (int r = radar->radius; r > 0; r -= 100) {
         if(count == 0) {
             for (int rr = -3; rr < 3; rr+=1) {
-                aacircleRGBA(radar->renderer, RADAR_CENTER(radar), RADAR_CENTER(radar), r+rr, radar->color.r, radar->color.g, radar->color.b, radar->color.a);
+                radar_primitive_ring(radar, RADAR_CENTER(radar), RADAR_CENTER(radar), r+rr, radar->color);
             }
         } else if (r <= 100){
-            aacircleRGBA(radar->renderer, RADAR_CENTER(radar), RADAR_CENTER(radar), r, radar->color.r, radar->color.g, radar->color.b, radar->color.a);
+            radar_primitive_ring(radar, RADAR_CENTER(radar), RADAR_CENTER(radar), r, radar->color);
         } else {
-            aacircleRGBA(radar->renderer, RADAR_CENTER(radar), RADAR_CENTER(radar), r-3, radar->color.r, radar->color.g, radar->color.b, radar->color.a);
-            aacircleRGBA(radar->renderer, RADAR_CENTER(radar), RADAR_CENTER(radar), r+3, radar->color.r, radar->color.g, radar->color.b, radar->color.a);
+            radar_primitive_ring(radar, RADAR_CENTER(radar), RADAR_CENTER(radar), r-3, radar->color);
+            radar_primitive_ring(radar, RADAR_CENTER(radar), RADAR_CENTER(radar), r+3, radar->color);
         }
         count++;
     }
@@ -135,33 +578,33 @@ void radar_draw_circles(const Radar *radar) {
 
 void radar_draw_bkg_grid(const Radar *radar) {
     // Draw normal grid lines
-    SDL_SetRenderDrawColor(radar->renderer, radar->grid.color.r, radar->grid.color.g, radar->grid.color.b, radar->grid.color.a);
+    const SDL_Color color = radar->grid.color;
 
     const int MAX = 2*radar->radius+2*radar->padding;
 
     // Draw horizontal lines
     int countG=0;
     for (int y = 0; y < MAX; y += radar->grid.cellSize) {
-        SDL_RenderDrawLine(radar->renderer, 0, y, MAX, y);
+        radar_primitive_hairline(radar, 0, y, MAX, y, color);
         if (radar->grid.thinCellNumber > 0 && countG % radar->grid.thinCellNumber == 0) {
-            SDL_RenderDrawLine(radar->renderer, 0, y+1, MAX, y+1);
-            SDL_RenderDrawLine(radar->renderer, 0, y-1, MAX, y-1);
+            radar_primitive_hairline(radar, 0, y+1, MAX, y+1, color);
+            radar_primitive_hairline(radar, 0, y-1, MAX, y-1, color);
         }
         countG++;
     }
-    SDL_RenderDrawLine(radar->renderer, 0, MAX-1, MAX, MAX-1);
+    radar_primitive_hairline(radar, 0, MAX-1, MAX, MAX-1, color);
 
     // Draw vertical lines
     countG=0;
     for (int x = 0; x < MAX; x += radar->grid.cellSize) {
-        SDL_RenderDrawLine(radar->renderer, x, 0, x, MAX);
+        radar_primitive_hairline(radar, x, 0, x, MAX, color);
         if (radar->grid.thinCellNumber > 0 && countG % radar->grid.thinCellNumber == 0) {
-            SDL_RenderDrawLine(radar->renderer, x+1, 0, x+1, MAX);
-            SDL_RenderDrawLine(radar->renderer, x-1, 0, x-1, MAX);
+            radar_primitive_hairline(radar, x+1, 0, x+1, MAX, color);
+            radar_primitive_hairline(radar, x-1, 0, x-1, MAX, color);
         }
         countG++;
     }
-    SDL_RenderDrawLine(radar->renderer, MAX-1, 0, MAX-1, MAX);
+    radar_primitive_hairline(radar, MAX-1, 0, MAX-1, MAX, color);
 }
 
 int radar_width(const Radar *radar) {
@@ -176,17 +619,187 @@ SDL_Rect radar_rectangle(const Radar *radar, int x, int y) {
     return (SDL_Rect){x, y, radar_width(radar), radar_height(radar)};
 }
 
+/**
+ * Whether the next radar_draw() would differ from the last one: the sweep turns, the trail has not
+ * come to rest yet, a contact moves or fades, or the scene was changed since the last draw.
+ * When no radar animates, the caller can stop drawing and wait for events.
+ */
+bool radar_is_animating(const Radar *radar) {
+    if (radar->needsRedraw || radar->settleSamples > 0) return true;
+    if (radar_sweep_rate(radar) != 0.0) return true;
+    for (int i = 0; i < radar->beam_count; ++i) {
+        if (radar->beams[i].rate != 0.0) return true;
+    }
+    return radar_object_list_is_animating(radar);
+}
+
+static Uint32 radarRedrawEvent = (Uint32) -1;
+
+/**
+ * SDL event type pushed by radar_request_redraw(), registered on first use (radar_init() does it).
+ * Returns (Uint32) -1 when SDL has no user event left.
+ */
+Uint32 radar_redraw_event(void) {
+    if (radarRedrawEvent == (Uint32) -1) {
+        radarRedrawEvent = SDL_RegisterEvents(1);
+    }
+    return radarRedrawEvent;
+}
+
+/**
+ * Wake up an idle main loop from any thread (contact feed, SDL timer) after changing what the radar shows.
+ * The event carries the radar in data1; its handler sets radar->needsRedraw on the main thread.
+ */
+void radar_request_redraw(Radar *radar) {
+    if (radarRedrawEvent == (Uint32) -1) return;
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = radarRedrawEvent;
+    event.user.data1 = radar;
+    if (SDL_PushEvent(&event) < 0) {
+        fprintf(stderr, "Could not request a radar redraw: %s\n", SDL_GetError());
+    }
+}
+
+/**
+ * Look at the world point (panX, panY) with the given magnification (1 when not positive).
+ * Contacts are mapped through it from the next frame; static layers that depend on it are baked again.
+ */
+void radar_set_view(Radar *radar, double zoom, double panX, double panY) {
+    radar->zoom = zoom > 0.0 ? zoom : 1.0;
+    radar->pan_x = panX;
+    radar->pan_y = panY;
+    radar->view.scale = radar->zoom / radar->range_scale;
+    radar->view.centerX = panX;
+    radar->view.centerY = panY;
+    radar->view.range = radar->radius / radar->view.scale;
+    radar->needsRedraw = true;
+    if (radar->terrain != NULL) {
+        // The terrain shadow moves with the view
+        radar_cache_release(radar->staticLayer);
+        radar->staticLayer = NULL;
+    }
+}
+
+/**
+ * Signed sweep speed in degrees per second
+ */
+double radar_sweep_rate(const Radar *radar) {
+    const double rate = radar->sweep_rate > 0.0 ? radar->sweep_rate : radar->speed * RADAR_SWEEP_NOMINAL_FPS;
+    return rate * radar->direction;
+}
+
+/**
+ * Turn the sweep by degrees (negative backwards) and record the swept sector; the angle stays in [0, 360).
+ * A sector scan reverses direction at the bounds of its sector.
+ */
+void radar_sweep_advance(Radar *radar, double degrees) {
+    const int heading = degrees < 0.0 ? -1 : 1;
+    int endHeading = heading;
+    radar->sweep = radar_beam_travel(&radar->angle, &endHeading, fabs(degrees), radar->sector_start, radar->sector_width);
+    if (endHeading != heading) {
+        radar->direction = -radar->direction;
+    }
+}
+
+/**
+ * Turn the sweep and the beams by the time elapsed since the last call, so the scan speed does not depend
+ * on the frame rate. The first frame, and the first after everything stood still (the loop may have slept),
+ * last a nominal frame.
+ */
+void radar_sweep_update(Radar *radar) {
+    const Uint64 now = SDL_GetPerformanceCounter();
+    // Idle when neither the sweep nor a beam moved on the last call and the trail was at rest
+    bool moved = radar->sweep.span != 0.0 || radar->settleSamples > 0;
+    for (int i = 0; i < radar->beam_count && !moved; ++i) {
+        moved = radar->beamState[i].sweep.span != 0.0;
+    }
+    double elapsed = 1.0 / RADAR_SWEEP_NOMINAL_FPS;
+    if (radar->sweepTicks != 0 && moved) {
+        elapsed = SDL_min((double) (now - radar->sweepTicks) / (double) SDL_GetPerformanceFrequency(), RADAR_SWEEP_MAX_DT);
+    }
+    radar->sweepTicks = now;
+    radar->sweepElapsed = elapsed;
+    radar_sweep_advance(radar, radar_sweep_rate(radar) * elapsed);
+    radar_beams_update(radar, elapsed);
+}
+
+/**
+ * Memory held by the radar, for reporting (e.g. printed at startup).
+ */
+RadarMemoryUsage radar_memory_usage(const Radar *radar) {
+    RadarMemoryUsage usage = {0};
+    if (radar->arena != NULL) {
+        usage.arenaUsed = radar->arena->used;
+        usage.arenaReserved = radar->arena->size;
+    }
+    if (radar->raster != NULL) {
+        const RadarRaster *raster = radar->raster;
+        usage.buffers += sizeof(RadarRasterCommand) * raster->commandCapacity;
+        usage.buffers += sizeof(int) * (2 * raster->binCapacity + raster->binCommandCapacity);
+        if (!raster->externalPixels) {
+            usage.buffers += sizeof(Uint32) * raster->ownedWidth * raster->ownedHeight;
+        }
+    }
+    if (radar->batch != NULL) {
+        usage.buffers += sizeof(SDL_Vertex) * radar->batch->vertexCapacity + sizeof(int) * radar->batch->indexCapacity;
+    }
+    if (radar->labels != NULL) {
+        const RadarBatch *batch = radar->labels->batch;
+        usage.buffers += sizeof(RadarLabelText) * radar->labels->textCount;
+        usage.buffers += sizeof(SDL_Vertex) * batch->vertexCapacity + sizeof(int) * batch->indexCapacity;
+        if (radar->labels->atlas != NULL) {
+            usage.shared += radar->labels->atlas->dataSize;
+        }
+    }
+    if (radar->staticLayer != NULL) {
+        usage.shared += radar->staticLayer->dataSize;
+    }
+    if (radar->remapLookup != NULL) {
+        usage.shared += radar->remapLookup->dataSize;
+    }
+    return usage;
+}
+
 SDL_Rect radar_rectangle_centered(const Radar *radar, int x, int y) {
     return (SDL_Rect){x-radar_width(radar)/2, y-radar_height(radar)/2, radar_width(radar), radar_height(radar)};
 }
 
+/**
+ * Release everything owned by the radar. The renderer belongs to the caller and can be shared
+ * by several radars, it is left untouched.
+ */
 void radar_cleanup(Radar *radar) {
     printf("Radar cleanup\n");
-    free(radar->trail_history);
     SDL_DestroyTexture(radar->workingTexture);
     radar->workingTexture = NULL;
     SDL_DestroyTexture(radar->renderedTexture);
     radar->renderedTexture = NULL;
-    SDL_DestroyRenderer(radar->renderer);
-    radar->renderer = NULL;
+    radar_cache_release(radar->staticLayer);
+    radar->staticLayer = NULL;
+    radar_cache_release(radar->remapLookup);
+    radar->remapLookup = NULL;
+    radar_release_pixel_target(radar);
+    radar_raster_destroy(radar->raster);
+    radar->raster = NULL;
+    radar_batch_destroy(radar->batch);
+    radar->batch = NULL;
+    radar_labels_destroy(radar->labels);
+    radar->labels = NULL;
+
+    // Trail, contacts, scope pixels, echo video, bloom levels, terrain horizon and tracks all go with the arena
+    radar->terrain = NULL;
+    radar->beamView = NULL;
+    radar_tracks_destroy(radar->tracks);
+    radar->tracks = NULL;
+    radar_echo_destroy(radar->echo);
+    radar->echo = NULL;
+    radar_bloom_destroy(radar->bloom);
+    radar->bloom = NULL;
+    radar->trail_history = NULL;
+    radar->remapPixels = NULL;
+    radar->radar_objects = NULL;
+    radar->contactPool = (RadarObjectPool){0};
+    radar_arena_destroy(radar->arena);
+    radar->arena = NULL;
 }
\ No newline at end of file
@@ -1,8 +1,15 @@
 #ifndef RADAR_H
 #define RADAR_H
 #include <SDL2/SDL.h>
+#include <math.h>
 #include <stdbool.h>
-#define ASSET_TEXTURE_BLUR "asserts/blur.png"
+#define RADAR_DEFAULT_MAX_CONTACTS 256
+#define RADAR_MIN_ZOOM 0.25
+#define RADAR_MAX_ZOOM 64.0
+#define RADAR_SWEEP_NOMINAL_FPS 60.0 // Frame rate a per frame speed stands for
+#define RADAR_SWEEP_MAX_DT 0.25      // Seconds, a longer frame (stall, wake up from idle) sweeps only this long
+#define RADAR_SWEEP_TRAIL_STEP 2.0   // Degrees between two trail samples along the path of the sweep
+#define RADAR_MAX_BEAMS 4            // Beams besides the main sweep
 
 typedef struct {
     double frequency;
@@ -16,6 +23,8 @@ typedef struct {
     Sint16* reverb_buffer;
     double phase;
     SDL_bool playing;
+    Uint64 last_callback;       // Performance counter of the previous callback, 0 after a pause
+    _Atomic(Uint32) underruns;  // Callbacks later than two buffers after the previous one
 } RadarAudioUserData;
 
 typedef struct {
@@ -33,6 +42,19 @@ typedef struct {
     int x, y;
 } RadarTrailPoint;
 
+typedef struct RadarProfiler RadarProfiler;
+typedef struct RadarCacheEntry RadarCacheEntry;
+typedef struct RadarRaster RadarRaster;
+typedef struct RadarBatch RadarBatch;
+typedef struct RadarArena RadarArena;
+typedef struct RadarEcho RadarEcho;
+typedef struct RadarProximity RadarProximity;
+typedef struct RadarLabels RadarLabels;
+typedef struct RadarBloom RadarBloom;
+typedef struct RadarTerrain RadarTerrain;
+typedef struct RadarBeamView RadarBeamView;
+typedef struct RadarTracks RadarTracks;
+
 /**
 * DEFAULT: Generic enemy
 * DRONE: Small, fast enemy drone
@@ -82,13 +104,11 @@ enum RadarObjectStatus {
 };
 
 /**
- * Each object has the same origin which is the center of the radar.
- * Origin is:
- *   (depends on where the object is rendered (radar->destination.x)) + radar->padding + radar->radius
- *   (depends on where the object is rendered (radar->destination.y)) + radar->padding + radar->radius
+ * Each object is positioned in world units from the antenna (x east, y south) and moves at speed world
+ * units per frame. Where it shows on the scope depends on the view (see RadarView); its radius is in scope pixels.
  */
 typedef struct {
-    int x, y;
+    double x, y;
     int radius;
     int radius_memory;
     double directionAngle;
@@ -100,8 +120,20 @@ typedef struct {
 typedef struct RadarObjectLinkedList {
     struct RadarObjectLinkedList* next;
     RadarObject object;
+    Uint32 id; // Given by the pool, unique for the life of the contact
 } RadarObjectLinkedList;
 
+/**
+ * Contact nodes, carved from the radar arena at init and recycled through a free list
+ */
+typedef struct {
+    RadarObjectLinkedList *nodes;
+    RadarObjectLinkedList *freeList;
+    int capacity;
+    int used;
+    Uint32 lastId;
+} RadarObjectPool;
+
 typedef struct {
     SDL_Color color;
     int cellSize;
@@ -113,6 +145,96 @@ typedef struct {
     int corner;
 } RadarCenterPoint;
 
+/**
+ * World to scope mapping, derived from range_scale, zoom and pan by radar_set_view()
+ */
+typedef struct {
+    double scale;            // Scope pixels per world unit
+    double centerX, centerY; // World point under the scope center
+    double range;            // World units from the scope center to its edge
+} RadarView;
+
+/**
+ * Sector covered by the sweep during the last frame: from start (degrees, the angle of the previous
+ * frame) over span degrees, negative when sweeping backwards, the full turn at most.
+ * A sector scan turning back within the frame covers from the bound it turned on instead.
+ */
+typedef struct {
+    double start;
+    double span;
+    double travel; // Signed degrees from the angle of the previous frame to the current one
+} RadarSweep;
+
+/**
+ * A beam turning on its own besides the main sweep, continuously or back and forth over a sector
+ */
+typedef struct {
+    double rate;         // Degrees per second, negative to start backwards, 0 holds the beam
+    double sector_start; // Sector scan from this bearing (degrees, clockwise from east like the sweep angle)
+    double sector_width; // over this many degrees and back, 0 for a full rotation
+    SDL_Color color;     // Beam line, the sweep line color when fully transparent
+} RadarBeamConfig;
+
+typedef struct {
+    double angle;
+    int heading; // +1 or -1, reversed at the sector bounds
+    RadarSweep sweep;
+} RadarBeam;
+
+/**
+ * Simulated raw video (see radar_echo.h), fields left to 0 take the defaults
+ */
+typedef struct {
+    int spokes;          // Bearing resolution, about one spoke per pixel of the circumference when 0
+    float noiseLevel;    // Mean receiver noise power
+    float clutterLevel;  // Mean sea clutter power next to the antenna
+    float clutterRange;  // Range in bins over which the clutter fades out (e-folding)
+    float contactGain;   // Peak return power of a contact
+    int cfarGuard;       // Guard bins on each side of the cell under test
+    int cfarTraining;    // Training bins on each side, averaged into the local noise estimate
+    float cfarScale;     // Detection threshold over the local mean, negative to show the raw video
+    SDL_Color color;     // Echo color, the scope color when left transparent
+} RadarEchoConfig;
+
+/**
+ * Glow of the bright parts of the scope (see radar_bloom.h), fields left to 0 take the defaults
+ */
+typedef struct {
+    int levels;      // Blur levels, each one half the size of the previous one
+    float threshold; // Brightness (0 to 1) from which a pixel starts to glow
+    float intensity; // Gain of the glow added back over the scope
+} RadarBloomConfig;
+
+/**
+ * SDL: primitives drawn by SDL2_gfx through the renderer.
+ * CPU: primitives rasterized in a CPU buffer, uploaded once per frame or sampled by the display remap.
+ * GEOMETRY: primitives tessellated into one vertex buffer, drawn with a single SDL_RenderGeometry per layer.
+ */
+typedef enum {
+    RADAR_BACKEND_SDL = 0,
+    RADAR_BACKEND_CPU = 1,
+    RADAR_BACKEND_GEOMETRY = 2
+} RadarBackend;
+
+/**
+ * Bytes held by a radar, see radar_memory_usage().
+ * Textures live in the renderer and are not counted.
+ */
+typedef struct {
+    size_t arenaUsed;     // Trail, contact pool, pixel buffer, echo video, bloom levels and terrain horizon carved from the arena
+    size_t arenaReserved; // Arena size, rounded up to whole huge pages when they back it
+    size_t buffers;       // Growable buffers outside the arena (raster commands, geometry batch, labels)
+    size_t shared;        // Cache data referenced by the radar (static layer pixels, display remap table, glyph metrics), shared with other radars
+} RadarMemoryUsage;
+
+/**
+ * Caller owned pixel buffer the radar draws into, wrapped by a software renderer
+ */
+typedef struct {
+    SDL_Surface *surface;
+    SDL_Renderer *renderer;
+} RadarPixelTarget;
+
 typedef struct {
     int direction;
     SDL_Rect destination;
@@ -135,12 +257,69 @@ typedef struct {
     RadarTrailPoint **trail_history;
     RadarAudioData audioData;
     RadarObjectLinkedList *radar_objects;
+    RadarProfiler *profiler;
+    RadarCacheEntry *staticLayer;
+    RadarCacheEntry *remapLookup; // Table of the current display mode, see radar_remap.h
+    Uint32 *remapPixels;
+    SDL_Point origin; // Top left corner of the scope in the current target, (0,0) in the working texture
+    RadarPixelTarget pixelTarget;
+    RadarBackend backend;
+    RadarRaster *raster;
+    RadarBatch *batch;
+    int max_contacts; // Size of the contact pool, RADAR_DEFAULT_MAX_CONTACTS when 0
+    bool huge_pages;  // Back the arena with huge pages when the system has them
+    RadarArena *arena;
+    RadarObjectPool contactPool;
+    int with_echo; // Simulated raw video under the sweep, configured by echoConfig
+    RadarEchoConfig echoConfig;
+    RadarEcho *echo;
+    int with_labels;        // Type, range and bearing of the contacts and ring ranges, see radar_labels_draw()
+    const char *label_font; // TrueType font of the labels, RADAR_FONT or a system font when NULL
+    int label_size;         // Point size of the labels, RADAR_LABEL_DEFAULT_SIZE when 0
+    RadarLabels *labels;
+    int with_bloom; // Glow pass over the scope once drawn, configured by bloomConfig
+    RadarBloomConfig bloomConfig;
+    RadarBloom *bloom;
+    double range_scale;   // World units per scope pixel at zoom 1, 1 when 0
+    double zoom;          // Magnification of the view, 1 when 0
+    double pan_x, pan_y;  // World point shown at the scope center
+    double theater_range; // World units from the antenna beyond which contacts are dropped, the scope range at RADAR_MIN_ZOOM when 0
+    RadarView view;
+    const char *terrain_file; // Elevation map (see radar_terrain.h), contacts behind the terrain are neither drawn nor pinged
+    RadarTerrain *terrain;
+    double sweep_rate;  // Degrees per second, multiplied by direction, speed x RADAR_SWEEP_NOMINAL_FPS when 0
+    double sector_start, sector_width; // Sector scan of the main sweep, see RadarBeamConfig, 0 width for a full rotation
+    RadarSweep sweep;
+    Uint64 sweepTicks;  // Performance counter of the last radar_sweep_update()
+    double sweepElapsed; // Seconds covered by the last radar_sweep_update()
+    RadarBeamConfig beams[RADAR_MAX_BEAMS];
+    int beam_count;
+    RadarBeam beamState[RADAR_MAX_BEAMS];
+    RadarBeamView *beamView; // Bearing sorted contacts and the hits of every beam in the last frame
+    int track_length;   // Past positions drawn behind each contact, up to RADAR_TRACK_MAX_LENGTH, no tails when 0
+    int track_interval; // Contact updates between two of them, RADAR_TRACK_DEFAULT_INTERVAL when 0
+    RadarTracks *tracks;
+    bool needsRedraw; // Scene changed outside of the animation (contacts added or removed), cleared by radar_draw()
+    double trailCarry;  // Degrees swept since the newest trail sample, signed with the travel
+    int settleSamples;  // Trail samples left to push before the trail of a stopped sweep comes to rest
+    double trailIdle;   // Seconds of stopped sweep not turned into settle samples yet
 } Radar;
 
+/**
+ * Center of the scope in the current drawing target
+ */
+#define RADAR_CENTER_X(radar) ((radar)->origin.x + (radar)->padding + (radar)->radius)
+#define RADAR_CENTER_Y(radar) ((radar)->origin.y + (radar)->padding + (radar)->radius)
+
 void radar_init(Radar *radar);
 void radar_render(Radar *radar);
+void radar_render_all(Radar *radars, int count);
 void radar_initWorkingTexture(Radar *radar);
 void radar_draw(Radar *radar);
+void radar_draw_static_layer(Radar *radar);
+void radar_draw_into(Radar *radar, SDL_Texture *target, int x, int y);
+void radar_draw_into_pixels(Radar *radar, void *pixels, int pitch, int width, int height, Uint32 format, int x, int y);
+void radar_release_pixel_target(Radar *radar);
 void radar_draw_middle_point(Radar *radar);
 void radar_draw_sweep_line(Radar *radar);
 void update_radar_trail(Radar* radar);
@@ -153,6 +332,26 @@ SDL_Rect radar_rectangle(const Radar *radar, int x, int y);
 SDL_Rect radar_rectangle_centered(const Radar *radar, int x, int y);
 int radar_width(const Radar *radar);
 int radar_height(const Radar *radar);
+RadarMemoryUsage radar_memory_usage(const Radar *radar);
+bool radar_is_animating(const Radar *radar);
+Uint32 radar_redraw_event(void);
+void radar_request_redraw(Radar *radar);
+void radar_set_view(Radar *radar, double zoom, double panX, double panY);
+double radar_sweep_rate(const Radar *radar);
+void radar_sweep_advance(Radar *radar, double degrees);
+void radar_sweep_update(Radar *radar);
+
+/**
+ * Whether a bearing (degrees) lies in the sector swept during the last frame, its start excluded:
+ * a contact on the border is crossed by one frame only.
+ */
+static inline bool radar_sweep_covers(const RadarSweep *sweep, double bearing) {
+    if (sweep->span >= 360.0 || sweep->span <= -360.0) return true;
+    double offset = sweep->span >= 0.0 ? bearing - sweep->start : sweep->start - bearing;
+    offset = fmod(offset, 360.0);
+    if (offset < 0.0) offset += 360.0;
+    return offset > 0.0 && offset <= fabs(sweep->span);
+}
 
 void radar_cleanup(Radar *radar);
 #endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "radar_arena.h"
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#ifdef __linux__
+/**
+ * Explicit huge pages first (needs pages reserved in /proc/sys/vm/nr_hugepages), then a regular
+ * mapping flagged for transparent huge pages. Returns NULL when both fail.
+ */
+static Uint8* radar_arena_map(size_t size, bool *hugePages) {
+    void *block = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (block != MAP_FAILED) {
+        *hugePages = true;
+        return block;
+    }
+    block = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED) return NULL;
+    *hugePages = madvise(block, size, MADV_HUGEPAGE) == 0;
+    return block;
+}
+#endif
+
+RadarArena* radar_arena_create(size_t size, bool hugePages) {
+    RadarArena *arena = calloc(1, sizeof(RadarArena));
+    if (arena == NULL) return NULL;
+
+#ifdef __linux__
+    if (hugePages) {
+        size_t mapSize = (size + RADAR_ARENA_HUGE_PAGE - 1) / RADAR_ARENA_HUGE_PAGE * RADAR_ARENA_HUGE_PAGE;
+        arena->base = radar_arena_map(mapSize, &arena->hugePages);
+        if (arena->base != NULL) {
+            arena->size = mapSize;
+            arena->mapped = true;
+            return arena;
+        }
+        fprintf(stderr, "Could not map a huge page arena, using the heap\n");
+    }
+#else
+    (void) hugePages;
+#endif
+
+    arena->base = calloc(1, size);
+    if (arena->base == NULL) {
+        fprintf(stderr, "Could not allocate a %zu bytes arena\n", size);
+        free(arena);
+        return NULL;
+    }
+    arena->size = size;
+    return arena;
+}
+
+/**
+ * Next block of the arena, aligned on RADAR_ARENA_ALIGN, or NULL when the arena is full
+ */
+void* radar_arena_alloc(RadarArena *arena, size_t size) {
+    if (arena == NULL) return NULL;
+    uintptr_t start = (uintptr_t) (arena->base + arena->used);
+    uintptr_t aligned = (start + RADAR_ARENA_ALIGN - 1) & ~(uintptr_t) (RADAR_ARENA_ALIGN - 1);
+    size_t offset = arena->used + (aligned - start);
+    if (offset + size > arena->size) {
+        fprintf(stderr, "Radar arena exhausted: %zu bytes requested, %zu left\n", size, arena->size - arena->used);
+        return NULL;
+    }
+    arena->used = offset + size;
+    return arena->base + offset;
+}
+
+void radar_arena_destroy(RadarArena *arena) {
+    if (arena == NULL) return;
+#ifdef __linux__
+    if (arena->mapped) {
+        munmap(arena->base, arena->size);
+        free(arena);
+        return;
+    }
+#endif
+    free(arena->base);
+    free(arena);
+}
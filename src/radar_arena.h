@@ -0,0 +1,32 @@
+#ifndef RADAR_ARENA_H
+#define RADAR_ARENA_H
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "radar.h"
+
+#define RADAR_ARENA_ALIGN 64 // Cache line, every block starts on its own line
+#define RADAR_ARENA_HUGE_PAGE (2 * 1024 * 1024)
+
+/**
+ * Single block holding the per radar buffers, sized once at init and released in one call.
+ * Blocks are carved in order and never freed individually; the memory starts zeroed.
+ */
+struct RadarArena {
+    Uint8 *base;
+    size_t size;
+    size_t used;
+    bool mapped;    // Comes from mmap (huge pages requested) rather than the heap
+    bool hugePages; // Backed by explicit or transparent huge pages
+};
+
+/**
+ * Room a block of this size takes in an arena, alignment padding included
+ */
+#define RADAR_ARENA_FOOTPRINT(size) ((((size) + RADAR_ARENA_ALIGN - 1) / RADAR_ARENA_ALIGN) * RADAR_ARENA_ALIGN + RADAR_ARENA_ALIGN)
+
+RadarArena* radar_arena_create(size_t size, bool hugePages);
+void* radar_arena_alloc(RadarArena *arena, size_t size);
+void radar_arena_destroy(RadarArena *arena);
+
+#endif
@@ -1,4 +1,5 @@
 #include "radar_audio.h"
+#include "radar_beam.h"
 #include <SDL2/SDL.h>
 #include <stdio.h>
 #include <math.h>
@@ -9,6 +10,14 @@
 void radar_audio_callback(void* userdata, Uint8* stream, int len) {
     RadarAudioUserData *audio_data = (RadarAudioUserData*) userdata;
 
+    // Mono 16 bits: a callback more than two buffers after the previous one let the device run dry
+    const Uint64 now = SDL_GetPerformanceCounter();
+    const Uint64 buffer = (Uint64) (len / sizeof(Sint16)) * SDL_GetPerformanceFrequency() / SAMPLE_RATE;
+    if (audio_data->last_callback != 0 && now - audio_data->last_callback > 2 * buffer) {
+        audio_data->underruns++;
+    }
+    audio_data->last_callback = now;
+
     if (SDL_FALSE == audio_data->playing) {
         SDL_memset(stream, 0, len);
         return;
@@ -138,33 +147,35 @@ void radar_audio_play(Radar *radar) {
     }
 }
 
+/**
+ * Stop the audio device while the main loop sleeps, so its callback does not keep writing silence.
+ * A ping still playing is let through, the device is paused on a later call.
+ */
+void radar_audio_set_idle(Radar *radar, bool idle) {
+    if (radar->audioData.initialized == 0) return;
+    SDL_LockAudioDevice(radar->audioData.deviceId);
+    const bool pause = idle && SDL_FALSE == radar->audioData.userData.playing;
+    if (!pause && SDL_GetAudioDeviceStatus(radar->audioData.deviceId) == SDL_AUDIO_PAUSED) {
+        radar->audioData.userData.last_callback = 0; // The gap of the pause is not an underrun
+    }
+    SDL_UnlockAudioDevice(radar->audioData.deviceId);
+    SDL_PauseAudioDevice(radar->audioData.deviceId, pause ? 1 : 0);
+}
+
 void radar_audio_cleanup(Radar *radar) {
     printf("Radar audio cleanup\n");
     SDL_CloseAudioDevice(radar->audioData.deviceId);
 }
 
+/**
+ * Ping for each contact crossed by the sweep or a beam during the last frame, as found by
+ * radar_beams_detect() over the whole swept sectors: a fast beam does not jump over contacts
+ */
 void radar_audio_trigger(Radar *radar) {
-    // Detect collision between the radar line and a dot point on the radar zone
-    if (radar->radar_objects == NULL) return;
-
-    RadarObjectLinkedList *radarObject = radar->radar_objects;
-    double rad = radar->angle * M_PI / 180.0f;
-    int radarLx=cos(rad)*radar->radius;
-    int radarLy=sin(rad)*radar->radius;
-    do {
-        if (
-            (
-                (radarLx < 0 && radarObject->object.x >= radarLx && radarObject->object.x <= 0) ||
-                (radarLx >= 0 && radarObject->object.x <= radarLx && radarObject->object.x >= 0)
-            ) &&
-            (
-                (radarLy < 0 && radarObject->object.y >= radarLy && radarObject->object.y <= 0) ||
-                (radarLy >= 0 && radarObject->object.y <= radarLy && radarObject->object.y >= 0)
-            )
-        ){
-            radar_audio_play(radar);
-        }
-    }while((radarObject = radarObject->next) != NULL);
+    if (radar->beamView == NULL || radar->audioData.initialized == 0) return;
+    for (int i = 0; i < radar->beamView->hitCount; ++i) {
+        radar_audio_play(radar);
+    }
 }
 
 int radar_audio_thread(void* radarP) {
@@ -15,6 +15,7 @@ void radar_audio_play(Radar *radar);
 void radar_audio_cleanup(Radar *radar);
 void radar_audio_init(Radar *radar);
 void radar_audio_trigger(Radar *radar);
+void radar_audio_set_idle(Radar *radar, bool idle);
 int radar_audio_thread(void *radarP);
 
 #endif
\ No newline at end of file
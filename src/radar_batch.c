@@ -0,0 +1,278 @@
+#include "radar_batch.h"
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+RadarBatch* radar_batch_create(void) {
+    RadarBatch *batch = calloc(1, sizeof(RadarBatch));
+    if (batch == NULL) {
+        fprintf(stderr, "Could not allocate the primitive batch\n");
+    }
+    return batch;
+}
+
+void radar_batch_destroy(RadarBatch *batch) {
+    if (batch == NULL) return;
+    free(batch->vertices);
+    free(batch->indices);
+    free(batch);
+}
+
+/**
+ * Make room for the next primitive, growing the buffers geometrically.
+ * Returns false (the primitive is dropped) when memory is exhausted.
+ */
+static bool radar_batch_reserve(RadarBatch *batch, int vertices, int indices) {
+    if (batch->vertexCount + vertices > batch->vertexCapacity) {
+        int capacity = batch->vertexCapacity > 0 ? batch->vertexCapacity : 1024;
+        while (capacity < batch->vertexCount + vertices) capacity *= 2;
+        SDL_Vertex *grown = realloc(batch->vertices, sizeof(SDL_Vertex) * capacity);
+        if (grown == NULL) return false;
+        batch->vertices = grown;
+        batch->vertexCapacity = capacity;
+    }
+    if (batch->indexCount + indices > batch->indexCapacity) {
+        int capacity = batch->indexCapacity > 0 ? batch->indexCapacity : 2048;
+        while (capacity < batch->indexCount + indices) capacity *= 2;
+        int *grown = realloc(batch->indices, sizeof(int) * capacity);
+        if (grown == NULL) return false;
+        batch->indices = grown;
+        batch->indexCapacity = capacity;
+    }
+    return true;
+}
+
+static inline int radar_batch_vertex(RadarBatch *batch, float x, float y, SDL_Color color) {
+    batch->vertices[batch->vertexCount] = (SDL_Vertex){{x, y}, color, {0.0f, 0.0f}};
+    return batch->vertexCount++;
+}
+
+static inline void radar_batch_triangle(RadarBatch *batch, int a, int b, int c) {
+    int *index = batch->indices + batch->indexCount;
+    index[0] = a;
+    index[1] = b;
+    index[2] = c;
+    batch->indexCount += 3;
+}
+
+// Two triangles, vertices a b c d in order around the quad
+static inline void radar_batch_quad(RadarBatch *batch, int a, int b, int c, int d) {
+    radar_batch_triangle(batch, a, b, c);
+    radar_batch_triangle(batch, a, c, d);
+}
+
+/**
+ * Number of polygon sides so the chords stay within RADAR_BATCH_MAX_ERROR of a circle of this radius
+ */
+static int radar_batch_segments(float radius) {
+    if (radius <= RADAR_BATCH_MAX_ERROR) return RADAR_BATCH_MIN_SEGMENTS;
+    int segments = (int) ceil(M_PI / acos(1.0 - RADAR_BATCH_MAX_ERROR / radius));
+    return SDL_clamp(segments, RADAR_BATCH_MIN_SEGMENTS, RADAR_BATCH_MAX_SEGMENTS);
+}
+
+/**
+ * Line of the given width as a quad, with a one pixel ramp to transparent on both sides.
+ * Lines one pixel wide or less collapse to a single center row of vertices.
+ */
+void radar_batch_line(RadarBatch *batch, float x1, float y1, float x2, float y2, float width, SDL_Color color) {
+    const float half = SDL_max(width, 1.0f) / 2.0f;
+    const float core = half - 0.5f;
+    const bool thin = core <= 0.0f;
+    if (!radar_batch_reserve(batch, thin ? 6 : 8, thin ? 12 : 18)) return;
+
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    float length = sqrtf(dx * dx + dy * dy);
+    if (length < 1e-3f) {
+        dx = 1.0f;
+        dy = 0.0f;
+    } else {
+        dx /= length;
+        dy /= length;
+    }
+    const float nx = -dy;
+    const float ny = dx;
+    const float outer = half + 0.5f;
+    SDL_Color clear = color;
+    clear.a = 0;
+
+    if (thin) {
+        int a0 = radar_batch_vertex(batch, x1 - nx * outer, y1 - ny * outer, clear);
+        int a1 = radar_batch_vertex(batch, x1, y1, color);
+        int a2 = radar_batch_vertex(batch, x1 + nx * outer, y1 + ny * outer, clear);
+        int b0 = radar_batch_vertex(batch, x2 - nx * outer, y2 - ny * outer, clear);
+        int b1 = radar_batch_vertex(batch, x2, y2, color);
+        int b2 = radar_batch_vertex(batch, x2 + nx * outer, y2 + ny * outer, clear);
+        radar_batch_quad(batch, a0, a1, b1, b0);
+        radar_batch_quad(batch, a1, a2, b2, b1);
+        return;
+    }
+
+    int a0 = radar_batch_vertex(batch, x1 - nx * outer, y1 - ny * outer, clear);
+    int a1 = radar_batch_vertex(batch, x1 - nx * core, y1 - ny * core, color);
+    int a2 = radar_batch_vertex(batch, x1 + nx * core, y1 + ny * core, color);
+    int a3 = radar_batch_vertex(batch, x1 + nx * outer, y1 + ny * outer, clear);
+    int b0 = radar_batch_vertex(batch, x2 - nx * outer, y2 - ny * outer, clear);
+    int b1 = radar_batch_vertex(batch, x2 - nx * core, y2 - ny * core, color);
+    int b2 = radar_batch_vertex(batch, x2 + nx * core, y2 + ny * core, color);
+    int b3 = radar_batch_vertex(batch, x2 + nx * outer, y2 + ny * outer, clear);
+    radar_batch_quad(batch, a0, a1, b1, b0);
+    radar_batch_quad(batch, a1, a2, b2, b1);
+    radar_batch_quad(batch, a2, a3, b3, b2);
+}
+
+/**
+ * One pixel wide anti-aliased circle: opaque on the radius, transparent one pixel inside and outside.
+ */
+void radar_batch_ring(RadarBatch *batch, float x, float y, float radius, SDL_Color color) {
+    const int segments = radar_batch_segments(radius);
+    if (!radar_batch_reserve(batch, 3 * segments, 12 * segments)) return;
+
+    SDL_Color clear = color;
+    clear.a = 0;
+    const float inner = SDL_max(radius - 1.0f, 0.0f);
+    const float outer = radius + 1.0f;
+    const double step = 2.0 * M_PI / segments;
+    const double stepCos = cos(step);
+    const double stepSin = sin(step);
+    double c = 1.0;
+    double s = 0.0;
+
+    const int first = batch->vertexCount;
+    for (int i = 0; i < segments; ++i) {
+        radar_batch_vertex(batch, x + (float) c * inner, y + (float) s * inner, clear);
+        radar_batch_vertex(batch, x + (float) c * radius, y + (float) s * radius, color);
+        radar_batch_vertex(batch, x + (float) c * outer, y + (float) s * outer, clear);
+        const double rotated = c * stepCos - s * stepSin;
+        s = s * stepCos + c * stepSin;
+        c = rotated;
+    }
+    for (int i = 0; i < segments; ++i) {
+        const int a = first + 3 * i;
+        const int b = first + 3 * ((i + 1) % segments);
+        radar_batch_quad(batch, a, a + 1, b + 1, b);
+        radar_batch_quad(batch, a + 1, a + 2, b + 2, b + 1);
+    }
+}
+
+/**
+ * Filled disc as a fan around the center, the rim fading out over one pixel.
+ */
+void radar_batch_filled_circle(RadarBatch *batch, float x, float y, float radius, SDL_Color color) {
+    const int segments = radar_batch_segments(radius);
+    if (!radar_batch_reserve(batch, 1 + 2 * segments, 9 * segments)) return;
+
+    SDL_Color clear = color;
+    clear.a = 0;
+    const float inner = SDL_max(radius - 0.5f, 0.0f);
+    const float outer = radius + 0.5f;
+    const double step = 2.0 * M_PI / segments;
+    const double stepCos = cos(step);
+    const double stepSin = sin(step);
+    double c = 1.0;
+    double s = 0.0;
+
+    const int center = radar_batch_vertex(batch, x, y, color);
+    for (int i = 0; i < segments; ++i) {
+        radar_batch_vertex(batch, x + (float) c * inner, y + (float) s * inner, color);
+        radar_batch_vertex(batch, x + (float) c * outer, y + (float) s * outer, clear);
+        const double rotated = c * stepCos - s * stepSin;
+        s = s * stepCos + c * stepSin;
+        c = rotated;
+    }
+    for (int i = 0; i < segments; ++i) {
+        const int a = center + 1 + 2 * i;
+        const int b = center + 1 + 2 * ((i + 1) % segments);
+        radar_batch_triangle(batch, center, a, b);
+        radar_batch_quad(batch, a, a + 1, b + 1, b);
+    }
+}
+
+/**
+ * Box between the pixel edges (x1, y1) and (x2, y2) with quarter circle corners, drawn as a fan
+ * around its center; the outline fades out over one pixel.
+ */
+void radar_batch_rounded_box(RadarBatch *batch, float x1, float y1, float x2, float y2, float corner, SDL_Color color) {
+    if (x1 > x2) { float t = x1; x1 = x2; x2 = t; }
+    if (y1 > y2) { float t = y1; y1 = y2; y2 = t; }
+    corner = SDL_clamp(corner, 0.0f, SDL_min(x2 - x1, y2 - y1) / 2.0f);
+
+    const int arcSegments = SDL_max(radar_batch_segments(corner) / 4, 1);
+    const int points = 4 * (arcSegments + 1);
+    if (!radar_batch_reserve(batch, 1 + 2 * points, 9 * points)) return;
+
+    SDL_Color clear = color;
+    clear.a = 0;
+    // Corner centers, clockwise from bottom right (y goes down)
+    const float cornerX[4] = {x2 - corner, x1 + corner, x1 + corner, x2 - corner};
+    const float cornerY[4] = {y2 - corner, y2 - corner, y1 + corner, y1 + corner};
+
+    const int center = radar_batch_vertex(batch, (x1 + x2) / 2.0f, (y1 + y2) / 2.0f, color);
+    for (int k = 0; k < 4; ++k) {
+        for (int i = 0; i <= arcSegments; ++i) {
+            const double angle = (k + (double) i / arcSegments) * M_PI / 2.0;
+            const float c = (float) cos(angle);
+            const float s = (float) sin(angle);
+            radar_batch_vertex(batch, cornerX[k] + c * (corner - 0.5f), cornerY[k] + s * (corner - 0.5f), color);
+            radar_batch_vertex(batch, cornerX[k] + c * (corner + 0.5f), cornerY[k] + s * (corner + 0.5f), clear);
+        }
+    }
+    for (int i = 0; i < points; ++i) {
+        const int a = center + 1 + 2 * i;
+        const int b = center + 1 + 2 * ((i + 1) % points);
+        radar_batch_triangle(batch, center, a, b);
+        radar_batch_quad(batch, a, a + 1, b + 1, b);
+    }
+}
+
+/**
+ * Plain axis aligned quad between the edges (x1, y1) and (x2, y2), no anti-aliasing ramp: four vertices,
+ * for the small primitives drawn by the thousand.
+ */
+void radar_batch_rect(RadarBatch *batch, float x1, float y1, float x2, float y2, SDL_Color color) {
+    if (!radar_batch_reserve(batch, 4, 6)) return;
+    const int a = radar_batch_vertex(batch, x1, y1, color);
+    const int b = radar_batch_vertex(batch, x2, y1, color);
+    const int c = radar_batch_vertex(batch, x2, y2, color);
+    const int d = radar_batch_vertex(batch, x1, y2, color);
+    radar_batch_quad(batch, a, b, c, d);
+}
+
+/**
+ * Axis aligned quad sampling the texture coordinates (u1, v1) - (u2, v2), tinted by color.
+ * Only meaningful in a batch flushed with radar_batch_flush_texture().
+ */
+void radar_batch_textured_quad(RadarBatch *batch, float x1, float y1, float x2, float y2,
+                               float u1, float v1, float u2, float v2, SDL_Color color) {
+    if (!radar_batch_reserve(batch, 4, 6)) return;
+    const int first = batch->vertexCount;
+    batch->vertices[first] = (SDL_Vertex){{x1, y1}, color, {u1, v1}};
+    batch->vertices[first + 1] = (SDL_Vertex){{x2, y1}, color, {u2, v1}};
+    batch->vertices[first + 2] = (SDL_Vertex){{x2, y2}, color, {u2, v2}};
+    batch->vertices[first + 3] = (SDL_Vertex){{x1, y2}, color, {u1, v2}};
+    batch->vertexCount += 4;
+    radar_batch_quad(batch, first, first + 1, first + 2, first + 3);
+}
+
+/**
+ * Send everything recorded since the last flush to the current render target in one call.
+ * The buffers are kept for the next batch.
+ */
+void radar_batch_flush(RadarBatch *batch, SDL_Renderer *renderer) {
+    radar_batch_flush_texture(batch, renderer, NULL);
+}
+
+/**
+ * Same as radar_batch_flush(), every vertex sampling the texture (NULL for plain colors)
+ */
+void radar_batch_flush_texture(RadarBatch *batch, SDL_Renderer *renderer, SDL_Texture *texture) {
+    if (batch == NULL || batch->indexCount == 0) return;
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    if (SDL_RenderGeometry(renderer, texture, batch->vertices, batch->vertexCount, batch->indices, batch->indexCount) < 0) {
+        fprintf(stderr, "Could not render the primitive batch: %s\n", SDL_GetError());
+    }
+    batch->flushCount++;
+    batch->vertexCount = 0;
+    batch->indexCount = 0;
+}
@@ -0,0 +1,39 @@
+#ifndef RADAR_BATCH_H
+#define RADAR_BATCH_H
+#include <SDL2/SDL.h>
+#include "radar.h"
+
+#define RADAR_BATCH_MAX_ERROR 0.25 // Max distance in pixels between a circle and its polygon
+#define RADAR_BATCH_MIN_SEGMENTS 8
+#define RADAR_BATCH_MAX_SEGMENTS 1024
+
+/**
+ * Immediate mode batcher of the scope primitives.
+ * Lines, circles and rounded boxes are tessellated (with a one pixel alpha ramp for anti-aliasing)
+ * into a single vertex/index buffer sent with one SDL_RenderGeometry call on flush.
+ * Buffers only grow: once the largest frame has been seen, drawing does not allocate anymore.
+ */
+struct RadarBatch {
+    SDL_Vertex *vertices;
+    int vertexCount;
+    int vertexCapacity;
+    int *indices;
+    int indexCount;
+    int indexCapacity;
+    int flushCount; // SDL_RenderGeometry calls issued since creation
+};
+
+RadarBatch* radar_batch_create(void);
+void radar_batch_destroy(RadarBatch *batch);
+
+void radar_batch_line(RadarBatch *batch, float x1, float y1, float x2, float y2, float width, SDL_Color color);
+void radar_batch_ring(RadarBatch *batch, float x, float y, float radius, SDL_Color color);
+void radar_batch_filled_circle(RadarBatch *batch, float x, float y, float radius, SDL_Color color);
+void radar_batch_rounded_box(RadarBatch *batch, float x1, float y1, float x2, float y2, float corner, SDL_Color color);
+void radar_batch_rect(RadarBatch *batch, float x1, float y1, float x2, float y2, SDL_Color color);
+void radar_batch_textured_quad(RadarBatch *batch, float x1, float y1, float x2, float y2,
+                               float u1, float v1, float u2, float v2, SDL_Color color);
+void radar_batch_flush(RadarBatch *batch, SDL_Renderer *renderer);
+void radar_batch_flush_texture(RadarBatch *batch, SDL_Renderer *renderer, SDL_Texture *texture);
+
+#endif
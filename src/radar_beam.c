@@ -0,0 +1,169 @@
+#include "radar_beam.h"
+#include "radar_arena.h"
+#include "radar_object.h"
+#include "radar_terrain.h"
+#include <math.h>
+#include <stdlib.h>
+
+static double radar_beam_wrap(double degrees) {
+    degrees = fmod(degrees, 360.0);
+    return degrees < 0.0 ? degrees + 360.0 : degrees;
+}
+
+/**
+ * Bytes radar_beam_view_create() carves from the arena
+ */
+size_t radar_beam_view_footprint(const Radar *radar) {
+    return RADAR_ARENA_FOOTPRINT(sizeof(RadarBeamView)) +
+           RADAR_ARENA_FOOTPRINT(sizeof(RadarBeamContact) * radar->max_contacts) +
+           RADAR_ARENA_FOOTPRINT(sizeof(RadarBeamHit) * radar->max_contacts * (RADAR_MAX_BEAMS + 1));
+}
+
+RadarBeamView* radar_beam_view_create(const Radar *radar, RadarArena *arena) {
+    RadarBeamView *view = radar_arena_alloc(arena, sizeof(RadarBeamView));
+    if (view == NULL) return NULL;
+    view->capacity = radar->max_contacts;
+    view->hitCapacity = radar->max_contacts * (RADAR_MAX_BEAMS + 1);
+    view->contacts = radar_arena_alloc(arena, sizeof(RadarBeamContact) * view->capacity);
+    view->hits = radar_arena_alloc(arena, sizeof(RadarBeamHit) * view->hitCapacity);
+    if (view->contacts == NULL || view->hits == NULL) return NULL;
+    return view;
+}
+
+/**
+ * Put each beam at the start of its sector (east for a rotating one), heading the way its rate says
+ */
+void radar_beams_init(Radar *radar) {
+    radar->beam_count = SDL_clamp(radar->beam_count, 0, RADAR_MAX_BEAMS);
+    for (int i = 0; i < radar->beam_count; ++i) {
+        const RadarBeamConfig *config = &radar->beams[i];
+        radar->beamState[i] = (RadarBeam){
+            .angle = radar_beam_wrap(config->sector_start),
+            .heading = config->rate < 0.0 ? -1 : 1
+        };
+    }
+}
+
+/**
+ * Move a beam by distance degrees along its heading and return the sector it covered.
+ * With a sector (0 < sectorWidth < 360) the beam turns back at each bound: the travel is folded on
+ * a cycle of twice the width, out then back, and the heading is the one it ends with.
+ */
+RadarSweep radar_beam_travel(double *angle, int *heading, double distance, double sectorStart, double sectorWidth) {
+    RadarSweep sweep = {*angle, 0.0, 0.0};
+    if (sectorWidth <= 0.0 || sectorWidth >= 360.0) {
+        sweep.span = *heading * SDL_min(distance, 360.0);
+        sweep.travel = sweep.span;
+        *angle = radar_beam_wrap(*angle + *heading * distance);
+        return sweep;
+    }
+
+    const double width = sectorWidth;
+    double position = radar_beam_wrap(*angle - sectorStart);
+    if (position > width) {
+        // Out of the sector (moved or started elsewhere): from the nearest bound
+        position = position - width < (360.0 - width) / 2.0 ? width : 0.0;
+    }
+    const double cycle = fmod((*heading > 0 ? position : 2.0 * width - position) + distance, 2.0 * width);
+    const double end = cycle <= width ? cycle : 2.0 * width - cycle;
+    const double toBound = *heading > 0 ? width - position : position;
+
+    if (distance <= toBound) {
+        sweep.start = sectorStart + position;
+        sweep.span = *heading * distance;
+    } else {
+        // Turned back within the frame: everything from the bound it turned on
+        double low = 0.0;
+        double high = width;
+        if (distance < toBound + width) {
+            if (*heading > 0) {
+                low = SDL_min(position, end);
+            } else {
+                high = SDL_max(position, end);
+            }
+        }
+        sweep.start = sectorStart + low;
+        sweep.span = high - low;
+    }
+    sweep.travel = end - position;
+    *heading = cycle <= width ? 1 : -1;
+    *angle = radar_beam_wrap(sectorStart + end);
+    return sweep;
+}
+
+void radar_beams_update(Radar *radar, double elapsed) {
+    for (int i = 0; i < radar->beam_count; ++i) {
+        RadarBeam *beam = &radar->beamState[i];
+        const RadarBeamConfig *config = &radar->beams[i];
+        beam->sweep = radar_beam_travel(&beam->angle, &beam->heading, fabs(config->rate) * elapsed,
+                                        config->sector_start, config->sector_width);
+    }
+}
+
+static int radar_beam_compare(const void *a, const void *b) {
+    const float left = ((const RadarBeamContact*) a)->bearing;
+    const float right = ((const RadarBeamContact*) b)->bearing;
+    return (left > right) - (left < right);
+}
+
+// First contact of the view at or after bearing
+static int radar_beam_lower_bound(const RadarBeamView *view, float bearing) {
+    int low = 0;
+    int high = view->count;
+    while (low < high) {
+        const int middle = (low + high) / 2;
+        if (view->contacts[middle].bearing < bearing) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static void radar_beam_hit_range(RadarBeamView *view, const RadarSweep *sweep, int beam, float from, float to) {
+    for (int i = radar_beam_lower_bound(view, from); i < view->count && view->contacts[i].bearing <= to; ++i) {
+        const RadarBeamContact *contact = &view->contacts[i];
+        if (view->hitCount == view->hitCapacity || !radar_sweep_covers(sweep, contact->bearing)) continue;
+        view->hits[view->hitCount++] = (RadarBeamHit){contact->id, beam, contact->bearing};
+    }
+}
+
+// Contacts in the swept sector, one or two runs of the view when it crosses east
+static void radar_beam_hits(RadarBeamView *view, const RadarSweep *sweep, int beam) {
+    if (sweep->span == 0.0) return;
+    const double width = SDL_min(fabs(sweep->span), 360.0);
+    const double from = radar_beam_wrap(sweep->span > 0.0 ? sweep->start : sweep->start + sweep->span);
+    radar_beam_hit_range(view, sweep, beam, (float) from, (float) SDL_min(from + width, 360.0));
+    if (from + width > 360.0) {
+        radar_beam_hit_range(view, sweep, beam, 0.0f, (float) (from + width - 360.0));
+    }
+}
+
+/**
+ * Sort the visible contacts by bearing, then collect the contacts crossed by the main sweep and by each
+ * beam during the last frame in view->hits
+ */
+void radar_beams_detect(Radar *radar) {
+    RadarBeamView *view = radar->beamView;
+    if (view == NULL) return;
+    view->count = 0;
+    view->hitCount = 0;
+
+    const int radiusSquared = radar->radius * radar->radius;
+    for (const RadarObjectLinkedList *node = radar->radar_objects; node != NULL && view->count < view->capacity; node = node->next) {
+        const RadarObject *object = &node->object;
+        if (object->status == RADAR_OBJECT_STATUS_DEAD) continue;
+        if (!radar_terrain_visible(radar->terrain, object->x, object->y)) continue;
+        int x, y;
+        if (!radar_object_project(radar, object, &x, &y) || x * x + y * y > radiusSquared) continue;
+        view->contacts[view->count++] = (RadarBeamContact){(float) radar_beam_wrap(atan2(y, x) * 180.0 / M_PI), node->id};
+    }
+    if (view->count == 0) return;
+    qsort(view->contacts, (size_t) view->count, sizeof(RadarBeamContact), radar_beam_compare);
+
+    radar_beam_hits(view, &radar->sweep, 0);
+    for (int i = 0; i < radar->beam_count; ++i) {
+        radar_beam_hits(view, &radar->beamState[i].sweep, i + 1);
+    }
+}
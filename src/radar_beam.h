@@ -0,0 +1,43 @@
+#ifndef RADAR_BEAM_H
+#define RADAR_BEAM_H
+#include <SDL2/SDL.h>
+#include "radar.h"
+
+/**
+ * Contact of the bearing sorted view
+ */
+typedef struct {
+    float bearing; // Degrees in [0, 360), same orientation as the sweep angle
+    Uint32 id;     // Stable pool id of the contact
+} RadarBeamContact;
+
+/**
+ * Contact crossed by a beam during the last frame
+ */
+typedef struct {
+    Uint32 id;
+    int beam;      // 0 for the main sweep, i + 1 for radar->beams[i]
+    float bearing;
+} RadarBeamHit;
+
+/**
+ * The contacts the beams can see (drawn on the scope and in sight over the terrain), sorted by bearing
+ * once per frame: each beam then only visits the contacts of the sector it swept, found by binary search.
+ */
+struct RadarBeamView {
+    RadarBeamContact *contacts;
+    int count;
+    int capacity;      // max_contacts
+    RadarBeamHit *hits;
+    int hitCount;
+    int hitCapacity;   // max_contacts for each beam and the main sweep
+};
+
+size_t radar_beam_view_footprint(const Radar *radar);
+RadarBeamView* radar_beam_view_create(const Radar *radar, RadarArena *arena);
+void radar_beams_init(Radar *radar);
+RadarSweep radar_beam_travel(double *angle, int *heading, double distance, double sectorStart, double sectorWidth);
+void radar_beams_update(Radar *radar, double elapsed);
+void radar_beams_detect(Radar *radar);
+
+#endif
@@ -0,0 +1,558 @@
+#include <SDL2/SDL.h>
+#include "radar.h"
+#include "radar_audio.h"
+#include "radar_sphere.h"
+#include "radar_remap.h"
+#include "radar_echo.h"
+#include "radar_bloom.h"
+#include "radar_beam.h"
+#include "radar_track.h"
+#include "radar_object.h"
+#include "radar_primitive.h"
+#include "radar_proximity.h"
+#include "radar_jobs.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Standalone benchmark of the radar pipeline.
+ * Every subsystem runs in isolation under the SDL software renderer with dummy video/audio drivers,
+ * for each combination of the swept parameters, and one result line is printed per run.
+ *
+ * Usage: radar_bench [--radius=400,800] [--trail=40] [--larger=400] [--contacts=10,100]
+ *                    [--sphere=0:0,30:15] [--only=static,trail,...] [--warmup=20] [--reps=200]
+ *                    [--backend=sdl,cpu,geometry] [--format=csv|json] [--seed=1]
+ * List parameters are comma separated, the trail larger value 0 means "same as the radius".
+ */
+
+#define BENCH_MAX_VALUES 16
+#define BENCH_AUDIO_SAMPLES 4096
+#define BENCH_PROXIMITY_NEIGHBOURS 4.0
+#define BENCH_TRACK_LENGTH 16
+
+typedef struct {
+    int values[BENCH_MAX_VALUES];
+    int count;
+} BenchIntList;
+
+typedef struct {
+    float y, x;
+} BenchSphereAngles;
+
+typedef struct {
+    BenchIntList radius;
+    BenchIntList trail;
+    BenchIntList larger;
+    BenchIntList contacts;
+    RadarBackend backends[BENCH_MAX_VALUES];
+    int backendCount;
+    BenchSphereAngles sphere[BENCH_MAX_VALUES];
+    int sphereCount;
+    const char *only;
+    int warmup;
+    int reps;
+    int json;
+    unsigned int seed;
+} BenchOptions;
+
+typedef struct {
+    int radius;
+    int trail;
+    int larger;
+    int contacts;
+    RadarBackend backend;
+    BenchSphereAngles sphere;
+} BenchCase;
+
+typedef struct {
+    double min_ms;
+    double median_ms;
+    double mean_ms;
+    double p99_ms;
+    double max_ms;
+    double stddev_ms;
+} BenchStats;
+
+typedef void (*BenchFunction)(Radar *radar, const BenchCase *benchCase);
+
+static void parse_int_list(const char *text, BenchIntList *list) {
+    list->count = 0;
+    while (*text != '\0' && list->count < BENCH_MAX_VALUES) {
+        char *end;
+        list->values[list->count++] = (int) strtol(text, &end, 10);
+        if (*end != ',') break;
+        text = end + 1;
+    }
+}
+
+static void parse_sphere_list(const char *text, BenchOptions *options) {
+    options->sphereCount = 0;
+    while (*text != '\0' && options->sphereCount < BENCH_MAX_VALUES) {
+        char *end;
+        BenchSphereAngles *angles = &options->sphere[options->sphereCount++];
+        angles->y = strtof(text, &end);
+        angles->x = *end == ':' ? strtof(end + 1, &end) : 0.0f;
+        if (*end != ',') break;
+        text = end + 1;
+    }
+}
+
+static void parse_backend_list(const char *text, BenchOptions *options) {
+    options->backendCount = 0;
+    while (*text != '\0' && options->backendCount < BENCH_MAX_VALUES) {
+        options->backends[options->backendCount++] =
+            strncmp(text, "cpu", 3) == 0 ? RADAR_BACKEND_CPU :
+            strncmp(text, "geometry", 8) == 0 ? RADAR_BACKEND_GEOMETRY : RADAR_BACKEND_SDL;
+        text = strchr(text, ',');
+        if (text == NULL) break;
+        text++;
+    }
+}
+
+static const char* backend_name(RadarBackend backend) {
+    switch (backend) {
+        case RADAR_BACKEND_CPU: return "cpu";
+        case RADAR_BACKEND_GEOMETRY: return "geometry";
+        default: return "sdl";
+    }
+}
+
+static int parse_options(int argc, char **argv, BenchOptions *options) {
+    *options = (BenchOptions){
+        .radius = {{400}, 1},
+        .trail = {{40}, 1},
+        .larger = {{0}, 1},
+        .contacts = {{10}, 1},
+        .backends = {RADAR_BACKEND_SDL},
+        .backendCount = 1,
+        .sphere = {{0.0f, 0.0f}},
+        .sphereCount = 1,
+        .only = NULL,
+        .warmup = 20,
+        .reps = 200,
+        .json = 0,
+        .seed = 1
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = strchr(arg, '=');
+        if (value == NULL) {
+            fprintf(stderr, "Unknown argument: %s\n", arg);
+            return -1;
+        }
+        value++;
+
+        if (strncmp(arg, "--radius=", 9) == 0) parse_int_list(value, &options->radius);
+        else if (strncmp(arg, "--trail=", 8) == 0) parse_int_list(value, &options->trail);
+        else if (strncmp(arg, "--larger=", 9) == 0) parse_int_list(value, &options->larger);
+        else if (strncmp(arg, "--contacts=", 11) == 0) parse_int_list(value, &options->contacts);
+        else if (strncmp(arg, "--sphere=", 9) == 0) parse_sphere_list(value, options);
+        else if (strncmp(arg, "--backend=", 10) == 0) parse_backend_list(value, options);
+        else if (strncmp(arg, "--only=", 7) == 0) options->only = value;
+        else if (strncmp(arg, "--warmup=", 9) == 0) options->warmup = atoi(value);
+        else if (strncmp(arg, "--reps=", 7) == 0) options->reps = atoi(value);
+        else if (strncmp(arg, "--format=", 9) == 0) options->json = strcmp(value, "json") == 0;
+        else if (strncmp(arg, "--seed=", 7) == 0) options->seed = (unsigned int) strtoul(value, NULL, 10);
+        else {
+            fprintf(stderr, "Unknown argument: %s\n", arg);
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < options->radius.count; ++i) {
+        if (options->radius.values[i] < 100) {
+            fprintf(stderr, "Radius must be at least 100 (got %d)\n", options->radius.values[i]);
+            return -1;
+        }
+    }
+    for (int i = 0; i < options->trail.count; ++i) {
+        if (options->trail.values[i] < 2) {
+            fprintf(stderr, "Trail must be at least 2 (got %d)\n", options->trail.values[i]);
+            return -1;
+        }
+    }
+    for (int i = 0; i < options->larger.count; ++i) {
+        if (options->larger.values[i] < 0) {
+            fprintf(stderr, "Larger must not be negative (got %d)\n", options->larger.values[i]);
+            return -1;
+        }
+    }
+    if (options->reps <= 0) options->reps = 1;
+    if (options->warmup < 0) options->warmup = 0;
+    return 0;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double da = *(const double*) a;
+    double db = *(const double*) b;
+    return (da > db) - (da < db);
+}
+
+static void compute_stats(double *samples, int count, BenchStats *stats) {
+    double sum = 0.0;
+    for (int i = 0; i < count; ++i) {
+        sum += samples[i];
+    }
+    double mean = sum / count;
+    double variance = 0.0;
+    for (int i = 0; i < count; ++i) {
+        variance += (samples[i] - mean) * (samples[i] - mean);
+    }
+
+    qsort(samples, count, sizeof(double), compare_double);
+    int p99 = (count * 99) / 100;
+    if (p99 >= count) p99 = count - 1;
+
+    stats->min_ms = samples[0];
+    stats->median_ms = samples[count / 2];
+    stats->mean_ms = mean;
+    stats->p99_ms = samples[p99];
+    stats->max_ms = samples[count - 1];
+    stats->stddev_ms = sqrt(variance / count);
+}
+
+/* ---- Subsystems ---- */
+
+// With the CPU and geometry backends primitives are only recorded until flushed
+static void bench_flush(Radar *radar) {
+    radar_primitive_flush(radar);
+}
+
+static void bench_static(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    radar_initWorkingTexture(radar);
+    radar_draw_bkg_grid(radar);
+    radar_draw_circles(radar);
+    bench_flush(radar);
+}
+
+static void bench_static_copy(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    radar_initWorkingTexture(radar);
+    radar_draw_static_layer(radar);
+    bench_flush(radar);
+}
+
+static void bench_trail(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    radar_initWorkingTexture(radar);
+    update_radar_trail(radar);
+    bench_flush(radar);
+    radar_sweep_advance(radar, radar->speed);
+}
+
+static void bench_echo(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    radar_initWorkingTexture(radar);
+    radar_echo_update(radar);
+    radar_echo_draw(radar);
+    bench_flush(radar);
+    radar_sweep_advance(radar, radar->speed);
+}
+
+static void bench_contact_update(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    radar_object_list_anim_update(radar);
+}
+
+static void bench_contact_render(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    radar_initWorkingTexture(radar);
+    radar_object_list_anim_render(radar);
+    bench_flush(radar);
+}
+
+static RadarProximity *benchProximity;
+
+static void bench_proximity(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    if (benchProximity == NULL) return;
+    radar_proximity_update(benchProximity, radar);
+}
+
+// Built with the radar but detached from it, so only the bloom subsystem draws with it
+static RadarBloom *benchBloom;
+
+/**
+ * Contact cores then the glow pass over them, the cost should not move with the contact count
+ */
+static void bench_bloom(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    if (benchBloom == NULL) return;
+    radar->bloom = benchBloom;
+    radar_initWorkingTexture(radar);
+    radar_object_list_anim_render(radar);
+    bench_flush(radar);
+    radar_bloom_apply(radar);
+    radar->bloom = NULL;
+}
+
+/**
+ * One frame of the main sweep and three beams: the bearing sort, then a binary search per swept sector
+ */
+static void bench_beams(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    radar_sweep_advance(radar, radar->speed);
+    radar_beams_update(radar, 1.0 / RADAR_SWEEP_NOMINAL_FPS);
+    radar_beams_detect(radar);
+}
+
+static RadarTracks *benchTracks;
+
+/**
+ * One recorded position per contact, then every tail drawn: BENCH_TRACK_LENGTH dots a contact once warm
+ */
+static void bench_tracks(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    if (benchTracks == NULL) return;
+    radar->tracks = benchTracks;
+    radar_tracks_record(radar);
+    radar_initWorkingTexture(radar);
+    radar_tracks_draw(radar);
+    bench_flush(radar);
+    radar->tracks = NULL;
+}
+
+static void bench_sphere(Radar *radar, const BenchCase *benchCase) {
+    render_uv_mapped_sphere(radar, benchCase->sphere.y, benchCase->sphere.x);
+}
+
+static void bench_bscope(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    radar_remap_render(radar, &(RadarDisplay){.mode = RADAR_DISPLAY_B_SCOPE});
+}
+
+static void bench_sector(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    radar_remap_render(radar, &(RadarDisplay){.mode = RADAR_DISPLAY_SECTOR, .sectorCenter = -90.0f, .sectorWidth = 60.0f});
+}
+
+static void bench_audio(Radar *radar, const BenchCase *benchCase) {
+    (void) benchCase;
+    static Sint16 stream[BENCH_AUDIO_SAMPLES];
+    RadarAudioUserData *userData = &radar->audioData.userData;
+    userData->samples_left = userData->ping_length_samples;
+    userData->playing = SDL_TRUE;
+    radar_audio_callback(userData, (Uint8*) stream, sizeof(stream));
+}
+
+typedef struct {
+    const char *name;
+    BenchFunction run;
+    int resetContacts; // Regenerate the contacts before each repetition (outside the timing)
+} BenchSubsystem;
+
+static const BenchSubsystem SUBSYSTEMS[] = {
+    {"static", bench_static, 0},
+    {"static_copy", bench_static_copy, 0},
+    {"trail", bench_trail, 0},
+    {"echo", bench_echo, 0},
+    {"contact_update", bench_contact_update, 1},
+    {"contact_render", bench_contact_render, 0},
+    {"proximity", bench_proximity, 0},
+    {"bloom", bench_bloom, 0},
+    {"beams", bench_beams, 0},
+    {"tracks", bench_tracks, 0},
+    {"sphere", bench_sphere, 0},
+    {"bscope", bench_bscope, 0},
+    {"sector", bench_sector, 0},
+    {"audio", bench_audio, 0},
+};
+
+static int subsystem_selected(const BenchOptions *options, const char *name) {
+    if (options->only == NULL) return 1;
+    size_t length = strlen(name);
+    const char *match = options->only;
+    while ((match = strstr(match, name)) != NULL) {
+        int startOk = match == options->only || match[-1] == ',';
+        int endOk = match[length] == '\0' || match[length] == ',';
+        if (startOk && endOk) return 1;
+        match += length;
+    }
+    return 0;
+}
+
+static void reset_contacts(Radar *radar, const BenchCase *benchCase) {
+    radar_object_list_clear(radar);
+    radar->radar_objects = benchCase->contacts > 0 ? radar_object_generate_random_list(radar, benchCase->contacts) : NULL;
+}
+
+static void bench_audio_setup(Radar *radar) {
+    RadarAudioUserData *userData = &radar->audioData.userData;
+    *userData = (RadarAudioUserData){0};
+    userData->ping_length_samples = (SAMPLE_RATE * PING_DURATION_MS) / 1000;
+    userData->reverb_buffer_size = (SAMPLE_RATE * REVERB_DELAY_MS) / 1000;
+    userData->reverb_buffer = (Sint16*) calloc(userData->reverb_buffer_size, sizeof(Sint16));
+}
+
+static void print_result(const BenchOptions *options, const char *name, const BenchCase *benchCase, const BenchStats *stats) {
+    if (options->json) {
+        printf("{\"subsystem\": \"%s\", \"backend\": \"%s\", \"radius\": %d, \"max_trail_length\": %d, \"trail_larger\": %d, \"contacts\": %d, "
+               "\"sphere_y\": %.1f, \"sphere_x\": %.1f, \"warmup\": %d, \"reps\": %d, "
+               "\"min_ms\": %.4f, \"median_ms\": %.4f, \"mean_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"stddev_ms\": %.4f}\n",
+            name, backend_name(benchCase->backend), benchCase->radius, benchCase->trail, benchCase->larger, benchCase->contacts,
+            benchCase->sphere.y, benchCase->sphere.x, options->warmup, options->reps,
+            stats->min_ms, stats->median_ms, stats->mean_ms, stats->p99_ms, stats->max_ms, stats->stddev_ms);
+    } else {
+        printf("%s,%s,%d,%d,%d,%d,%.1f,%.1f,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+            name, backend_name(benchCase->backend), benchCase->radius, benchCase->trail, benchCase->larger, benchCase->contacts,
+            benchCase->sphere.y, benchCase->sphere.x, options->warmup, options->reps,
+            stats->min_ms, stats->median_ms, stats->mean_ms, stats->p99_ms, stats->max_ms, stats->stddev_ms);
+    }
+    fflush(stdout);
+}
+
+static int run_case(const BenchOptions *options, const BenchCase *benchCase, double *samples) {
+    Radar radar = {
+        .direction = 1,
+        .angle = 0.0,
+        .padding = 0,
+        .radius = benchCase->radius,
+        .with_grid = 1,
+        .speed = 2.0,
+        .color = {100, 255, 100, 255},
+        .centerPoint = {10, 10},
+        .sweepLineColor = {255, 255, 255, 255},
+        .grid = {
+            .color = {100, 150, 100, 100},
+            .cellSize = 40,
+            .thinCellNumber = -1
+        },
+        .max_trail_length = benchCase->trail,
+        .trail_larger = benchCase->larger,
+        .trailColor = {106, 220, 153, 255},
+        .backend = benchCase->backend,
+        .max_contacts = benchCase->contacts,
+        .with_echo = 1,
+        .with_bloom = 1,
+        .beams = {
+            {.rate = 360.0},
+            {.rate = -720.0},
+            {.rate = 240.0, .sector_start = 300.0, .sector_width = 120.0}
+        },
+        .beam_count = 3,
+        .track_length = BENCH_TRACK_LENGTH,
+        .track_interval = 1,
+    };
+    radar.destination = radar_rectangle(&radar, 0, 0);
+
+    SDL_Surface *screen = SDL_CreateRGBSurfaceWithFormat(0, radar_width(&radar), radar_height(&radar), 32, SDL_PIXELFORMAT_RGBA8888);
+    if (screen == NULL) {
+        fprintf(stderr, "Surface creation failed: %s\n", SDL_GetError());
+        return -1;
+    }
+    radar.renderer = SDL_CreateSoftwareRenderer(screen);
+    if (radar.renderer == NULL) {
+        fprintf(stderr, "Software renderer creation failed: %s\n", SDL_GetError());
+        SDL_FreeSurface(screen);
+        return -1;
+    }
+    SDL_SetRenderDrawBlendMode(radar.renderer, SDL_BLENDMODE_BLEND);
+
+    radar_init(&radar);
+    bench_audio_setup(&radar);
+    benchBloom = radar.bloom;
+    radar.bloom = NULL;
+    benchTracks = radar.tracks;
+    radar.tracks = NULL;
+
+    // Generated contacts fill a radius/2 square, half of them allies: ranges so each enemy has
+    // BENCH_PROXIMITY_NEIGHBOURS allies in range on average, whatever the contact count
+    benchProximity = radar_proximity_create();
+    if (benchProximity != NULL && benchCase->contacts > 0) {
+        const float range = (float) (benchCase->radius * sqrt(BENCH_PROXIMITY_NEIGHBOURS / (2.0 * M_PI * benchCase->contacts)));
+        radar_proximity_set_range(benchProximity, 0, 0, range);
+    }
+
+    // Prime the working texture so the sphere projection has a complete scope to sample
+    radar_initWorkingTexture(&radar);
+    radar_draw(&radar);
+
+    for (size_t s = 0; s < SDL_arraysize(SUBSYSTEMS); ++s) {
+        const BenchSubsystem *subsystem = &SUBSYSTEMS[s];
+        if (!subsystem_selected(options, subsystem->name)) continue;
+
+        srand(options->seed);
+        reset_contacts(&radar, benchCase);
+        for (int i = 0; i < options->warmup; ++i) {
+            if (subsystem->resetContacts) reset_contacts(&radar, benchCase);
+            subsystem->run(&radar, benchCase);
+        }
+
+        for (int i = 0; i < options->reps; ++i) {
+            if (subsystem->resetContacts) reset_contacts(&radar, benchCase);
+            Uint64 start = SDL_GetPerformanceCounter();
+            subsystem->run(&radar, benchCase);
+            Uint64 end = SDL_GetPerformanceCounter();
+            samples[i] = (double) (end - start) * 1000.0 / (double) SDL_GetPerformanceFrequency();
+        }
+
+        BenchStats stats;
+        compute_stats(samples, options->reps, &stats);
+        print_result(options, subsystem->name, benchCase, &stats);
+    }
+
+    radar_proximity_destroy(benchProximity);
+    benchProximity = NULL;
+    radar.bloom = benchBloom;
+    benchBloom = NULL;
+    radar.tracks = benchTracks;
+    benchTracks = NULL;
+    free(radar.audioData.userData.reverb_buffer);
+    SDL_Renderer *renderer = radar.renderer;
+    radar_cleanup(&radar);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(screen);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    if (parse_options(argc, argv, &options) != 0) {
+        return 1;
+    }
+
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        fprintf(stderr, "SDL initialization failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    double *samples = malloc(sizeof(double) * options.reps);
+    if (samples == NULL) {
+        SDL_Quit();
+        return 1;
+    }
+
+    if (!options.json) {
+        printf("subsystem,backend,radius,max_trail_length,trail_larger,contacts,sphere_y,sphere_x,warmup,reps,"
+               "min_ms,median_ms,mean_ms,p99_ms,max_ms,stddev_ms\n");
+    }
+
+    int status = 0;
+    for (int r = 0; r < options.radius.count && status == 0; ++r)
+    for (int t = 0; t < options.trail.count && status == 0; ++t)
+    for (int l = 0; l < options.larger.count && status == 0; ++l)
+    for (int c = 0; c < options.contacts.count && status == 0; ++c)
+    for (int b = 0; b < options.backendCount && status == 0; ++b)
+    for (int a = 0; a < options.sphereCount && status == 0; ++a) {
+        BenchCase benchCase = {
+            .radius = options.radius.values[r],
+            .trail = options.trail.values[t],
+            .larger = options.larger.values[l] > 0 ? options.larger.values[l] : options.radius.values[r],
+            .contacts = options.contacts.values[c],
+            .backend = options.backends[b],
+            .sphere = options.sphere[a]
+        };
+        status = run_case(&options, &benchCase, samples);
+    }
+
+    free(samples);
+    radar_jobs_shutdown();
+    SDL_Quit();
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,440 @@
+#include "radar_bloom.h"
+#include "radar_arena.h"
+#include "radar_jobs.h"
+#include "radar_raster.h"
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define RADAR_BLOOM_SPAN 64 // Pixels upsampled at a time, kept on the stack
+#define RADAR_BLOOM_ALPHA_GAIN 4.0f // Texture alpha per unit of glow, so faint glow over transparent pixels fades out
+
+// 5 tap binomial kernel 1 4 6 4 1
+#define RADAR_BLOOM_W0 (1.0f / 16.0f)
+#define RADAR_BLOOM_W1 (4.0f / 16.0f)
+#define RADAR_BLOOM_W2 (6.0f / 16.0f)
+
+static RadarBloomConfig radar_bloom_resolve(const Radar *radar) {
+    RadarBloomConfig config = radar->bloomConfig;
+    if (config.levels <= 0) config.levels = RADAR_BLOOM_LEVELS;
+    config.levels = SDL_min(config.levels, RADAR_BLOOM_MAX_LEVELS);
+    if (config.threshold <= 0.0f) config.threshold = RADAR_BLOOM_THRESHOLD;
+    config.threshold = SDL_min(config.threshold, 0.99f);
+    if (config.intensity <= 0.0f) config.intensity = RADAR_BLOOM_INTENSITY;
+    return config;
+}
+
+/**
+ * Size of each level, half of the previous one, the first one half of the scope.
+ * Returns the number of levels, fewer than configured when the scope is too small for them.
+ */
+static int radar_bloom_level_sizes(const Radar *radar, int levels, int *widths, int *heights) {
+    int width = radar_width(radar);
+    int height = radar_height(radar);
+    int count = 0;
+    for (int i = 0; i < levels; ++i) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        if (i > 0 && (width < RADAR_BLOOM_MIN_LEVEL_SIZE || height < RADAR_BLOOM_MIN_LEVEL_SIZE)) break;
+        widths[i] = width;
+        heights[i] = height;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Bytes radar_bloom_create() carves from the arena
+ */
+size_t radar_bloom_footprint(const Radar *radar) {
+    const RadarBloomConfig config = radar_bloom_resolve(radar);
+    int widths[RADAR_BLOOM_MAX_LEVELS];
+    int heights[RADAR_BLOOM_MAX_LEVELS];
+    const int count = radar_bloom_level_sizes(radar, config.levels, widths, heights);
+    size_t size = RADAR_ARENA_FOOTPRINT(sizeof(RadarBloom));
+    for (int i = 0; i < count; ++i) {
+        size += 6 * RADAR_ARENA_FOOTPRINT(sizeof(float) * widths[i] * heights[i]);
+    }
+    if (count > 0) {
+        size += RADAR_ARENA_FOOTPRINT(sizeof(Uint32) * widths[0] * heights[0]);
+    }
+    return size;
+}
+
+RadarBloom* radar_bloom_create(Radar *radar, RadarArena *arena) {
+    RadarBloom *bloom = radar_arena_alloc(arena, sizeof(RadarBloom));
+    if (bloom == NULL) return NULL;
+    bloom->config = radar_bloom_resolve(radar);
+    bloom->width = radar_width(radar);
+    bloom->height = radar_height(radar);
+
+    int widths[RADAR_BLOOM_MAX_LEVELS];
+    int heights[RADAR_BLOOM_MAX_LEVELS];
+    bloom->levelCount = radar_bloom_level_sizes(radar, bloom->config.levels, widths, heights);
+    for (int i = 0; i < bloom->levelCount; ++i) {
+        RadarBloomLevel *level = &bloom->levels[i];
+        level->width = widths[i];
+        level->height = heights[i];
+        for (int c = 0; c < 3; ++c) {
+            level->planes[c] = radar_arena_alloc(arena, sizeof(float) * widths[i] * heights[i]);
+            level->scratch[c] = radar_arena_alloc(arena, sizeof(float) * widths[i] * heights[i]);
+            if (level->planes[c] == NULL || level->scratch[c] == NULL) {
+                fprintf(stderr, "Could not allocate the bloom buffers\n");
+                return NULL;
+            }
+        }
+    }
+    if (bloom->levelCount == 0) return NULL;
+    bloom->pixels = radar_arena_alloc(arena, sizeof(Uint32) * widths[0] * heights[0]);
+    if (bloom->pixels == NULL) {
+        fprintf(stderr, "Could not allocate the bloom buffers\n");
+        return NULL;
+    }
+    return bloom;
+}
+
+/**
+ * The buffers go with the radar arena, only the texture is released here
+ */
+void radar_bloom_destroy(RadarBloom *bloom) {
+    if (bloom == NULL) return;
+    if (bloom->texture != NULL) {
+        SDL_DestroyTexture(bloom->texture);
+        bloom->texture = NULL;
+    }
+}
+
+/**
+ * Average of a 2x2 block of the scope, weighted by how far its brightest channel goes over the threshold
+ */
+static void radar_bloom_bright_pass_row(RadarBloom *bloom, int y) {
+    const RadarBloomLevel *level = &bloom->levels[0];
+    const float threshold = bloom->config.threshold;
+    const float scale = 1.0f / (4.0f * 255.0f * 255.0f);
+    const int y0 = 2 * y;
+    const int y1 = SDL_min(2 * y + 1, bloom->height - 1);
+    const Uint32 *rows[2] = {bloom->source + (size_t) y0 * bloom->sourcePitch, bloom->source + (size_t) y1 * bloom->sourcePitch};
+    float *r = level->planes[0] + (size_t) y * level->width;
+    float *g = level->planes[1] + (size_t) y * level->width;
+    float *b = level->planes[2] + (size_t) y * level->width;
+
+    for (int x = 0; x < level->width; ++x) {
+        const int x0 = 2 * x;
+        const int x1 = SDL_min(2 * x + 1, bloom->width - 1);
+        Uint32 sumR = 0, sumG = 0, sumB = 0;
+        for (int k = 0; k < 2; ++k) {
+            const Uint32 p0 = rows[k][x0];
+            const Uint32 p1 = rows[k][x1];
+            // Shown color: RGB times alpha
+            sumR += (p0 >> 24) * (p0 & 0xff) + (p1 >> 24) * (p1 & 0xff);
+            sumG += ((p0 >> 16) & 0xff) * (p0 & 0xff) + ((p1 >> 16) & 0xff) * (p1 & 0xff);
+            sumB += ((p0 >> 8) & 0xff) * (p0 & 0xff) + ((p1 >> 8) & 0xff) * (p1 & 0xff);
+        }
+        const float red = sumR * scale;
+        const float green = sumG * scale;
+        const float blue = sumB * scale;
+        const float brightness = SDL_max(red, SDL_max(green, blue));
+        const float weight = SDL_clamp((brightness - threshold) / (1.0f - threshold), 0.0f, 1.0f);
+        r[x] = red * weight;
+        g[x] = green * weight;
+        b[x] = blue * weight;
+    }
+}
+
+static void radar_bloom_downsample_row(RadarBloom *bloom, int y) {
+    const RadarBloomLevel *from = &bloom->levels[bloom->level - 1];
+    const RadarBloomLevel *to = &bloom->levels[bloom->level];
+    const int y0 = 2 * y;
+    const int y1 = SDL_min(2 * y + 1, from->height - 1);
+    for (int c = 0; c < 3; ++c) {
+        const float *row0 = from->planes[c] + (size_t) y0 * from->width;
+        const float *row1 = from->planes[c] + (size_t) y1 * from->width;
+        float *out = to->planes[c] + (size_t) y * to->width;
+        for (int x = 0; x < to->width; ++x) {
+            const int x0 = 2 * x;
+            const int x1 = SDL_min(2 * x + 1, from->width - 1);
+            out[x] = 0.25f * ((row0[x0] + row0[x1]) + (row1[x0] + row1[x1]));
+        }
+    }
+}
+
+// Kernel at x with the row clamped on both ends, same evaluation order as the SIMD path
+static inline float radar_bloom_tap(const float *row, int x, int width) {
+    const float a = row[SDL_max(x - 2, 0)];
+    const float b = row[SDL_max(x - 1, 0)];
+    const float c = row[x];
+    const float d = row[SDL_min(x + 1, width - 1)];
+    const float e = row[SDL_min(x + 2, width - 1)];
+    return ((a + e) * RADAR_BLOOM_W0 + (b + d) * RADAR_BLOOM_W1) + c * RADAR_BLOOM_W2;
+}
+
+static void radar_bloom_blur_row(const float *source, float *destination, int width) {
+    int x = 0;
+    for (; x < SDL_min(2, width); ++x) {
+        destination[x] = radar_bloom_tap(source, x, width);
+    }
+#ifdef __SSE2__
+    const __m128 w0 = _mm_set1_ps(RADAR_BLOOM_W0);
+    const __m128 w1 = _mm_set1_ps(RADAR_BLOOM_W1);
+    const __m128 w2 = _mm_set1_ps(RADAR_BLOOM_W2);
+    for (; x + 4 <= width - 2; x += 4) {
+        const __m128 a = _mm_loadu_ps(source + x - 2);
+        const __m128 b = _mm_loadu_ps(source + x - 1);
+        const __m128 c = _mm_loadu_ps(source + x);
+        const __m128 d = _mm_loadu_ps(source + x + 1);
+        const __m128 e = _mm_loadu_ps(source + x + 2);
+        const __m128 outer = _mm_add_ps(_mm_mul_ps(_mm_add_ps(a, e), w0), _mm_mul_ps(_mm_add_ps(b, d), w1));
+        _mm_storeu_ps(destination + x, _mm_add_ps(outer, _mm_mul_ps(c, w2)));
+    }
+#endif
+    for (; x < width; ++x) {
+        destination[x] = radar_bloom_tap(source, x, width);
+    }
+}
+
+/**
+ * Vertical pass over the columns [first, last) of a level, four columns per SIMD step
+ */
+static void radar_bloom_blur_columns(const float *source, float *destination, int width, int height, int first, int last) {
+    for (int y = 0; y < height; ++y) {
+        const float *a = source + (size_t) SDL_max(y - 2, 0) * width;
+        const float *b = source + (size_t) SDL_max(y - 1, 0) * width;
+        const float *c = source + (size_t) y * width;
+        const float *d = source + (size_t) SDL_min(y + 1, height - 1) * width;
+        const float *e = source + (size_t) SDL_min(y + 2, height - 1) * width;
+        float *out = destination + (size_t) y * width;
+        int x = first;
+#ifdef __SSE2__
+        const __m128 w0 = _mm_set1_ps(RADAR_BLOOM_W0);
+        const __m128 w1 = _mm_set1_ps(RADAR_BLOOM_W1);
+        const __m128 w2 = _mm_set1_ps(RADAR_BLOOM_W2);
+        for (; x + 4 <= last; x += 4) {
+            const __m128 outer = _mm_add_ps(
+                _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(a + x), _mm_loadu_ps(e + x)), w0),
+                _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(b + x), _mm_loadu_ps(d + x)), w1));
+            _mm_storeu_ps(out + x, _mm_add_ps(outer, _mm_mul_ps(_mm_loadu_ps(c + x), w2)));
+        }
+#endif
+        for (; x < last; ++x) {
+            out[x] = ((a[x] + e[x]) * RADAR_BLOOM_W0 + (b[x] + d[x]) * RADAR_BLOOM_W1) + c[x] * RADAR_BLOOM_W2;
+        }
+    }
+}
+
+/**
+ * Pixels [first, first + count) of row y of a level twice the size of the plane, bilinear.
+ * Doubling puts every output pixel a quarter of a pixel away from the nearest input, so the
+ * weights are always 3/4 and 1/4; indices are clamped on the edges.
+ */
+static void radar_bloom_upsample_span(const float *plane, int width, int height, int y, int first, int count, float *out) {
+    const int closest = SDL_min(y >> 1, height - 1);
+    const int other = SDL_clamp((y & 1) ? closest + 1 : closest - 1, 0, height - 1);
+    const float *rowNear = plane + (size_t) closest * width;
+    const float *rowFar = plane + (size_t) other * width;
+    for (int k = 0; k < count; ++k) {
+        const int x = first + k;
+        const int i = SDL_min(x >> 1, width - 1);
+        const int j = SDL_clamp((x & 1) ? i + 1 : i - 1, 0, width - 1);
+        const float columnNear = 0.75f * rowNear[i] + 0.25f * rowFar[i];
+        const float columnFar = 0.75f * rowNear[j] + 0.25f * rowFar[j];
+        out[k] = 0.75f * columnNear + 0.25f * columnFar;
+    }
+}
+
+static void radar_bloom_upsample_row(RadarBloom *bloom, int y) {
+    const RadarBloomLevel *from = &bloom->levels[bloom->level + 1];
+    const RadarBloomLevel *to = &bloom->levels[bloom->level];
+    float glow[RADAR_BLOOM_SPAN];
+    for (int c = 0; c < 3; ++c) {
+        float *out = to->planes[c] + (size_t) y * to->width;
+        for (int x = 0; x < to->width; x += RADAR_BLOOM_SPAN) {
+            const int count = SDL_min(RADAR_BLOOM_SPAN, to->width - x);
+            radar_bloom_upsample_span(from->planes[c], from->width, from->height, y, x, count, glow);
+            for (int k = 0; k < count; ++k) {
+                out[x + k] += glow[k];
+            }
+        }
+    }
+}
+
+/**
+ * Glow in RGBA8888 for the additive texture copy; alpha rises with the glow so it also shows over
+ * transparent parts of the scope
+ */
+static void radar_bloom_pack_row(RadarBloom *bloom, int y) {
+    const RadarBloomLevel *level = &bloom->levels[0];
+    const float gain = 255.0f * bloom->config.intensity;
+    const size_t offset = (size_t) y * level->width;
+    for (int x = 0; x < level->width; ++x) {
+        const float r = SDL_min(level->planes[0][offset + x] * gain, 255.0f);
+        const float g = SDL_min(level->planes[1][offset + x] * gain, 255.0f);
+        const float b = SDL_min(level->planes[2][offset + x] * gain, 255.0f);
+        const float a = SDL_min(SDL_max(r, SDL_max(g, b)) * RADAR_BLOOM_ALPHA_GAIN, 255.0f);
+        bloom->pixels[offset + x] = ((Uint32) r << 24) | ((Uint32) g << 16) | ((Uint32) b << 8) | (Uint32) a;
+    }
+}
+
+/**
+ * CPU backend: add the glow to the shown color of each scope pixel, raising the alpha as needed
+ */
+static void radar_bloom_composite_row(RadarBloom *bloom, int y) {
+    const RadarBloomLevel *level = &bloom->levels[0];
+    const float gain = 255.0f * bloom->config.intensity;
+    Uint32 *row = bloom->source + (size_t) y * bloom->sourcePitch;
+    float glow[3][RADAR_BLOOM_SPAN];
+    for (int first = 0; first < bloom->width; first += RADAR_BLOOM_SPAN) {
+        const int count = SDL_min(RADAR_BLOOM_SPAN, bloom->width - first);
+        for (int c = 0; c < 3; ++c) {
+            radar_bloom_upsample_span(level->planes[c], level->width, level->height, y, first, count, glow[c]);
+        }
+        for (int k = 0; k < count; ++k) {
+            const float glowR = glow[0][k] * gain;
+            const float glowG = glow[1][k] * gain;
+            const float glowB = glow[2][k] * gain;
+            if (glowR + glowG + glowB < 0.5f) continue;
+
+            const Uint32 p = row[first + k];
+            const float alpha = (p & 0xff) / 255.0f;
+            const float r = SDL_min((p >> 24) * alpha + glowR, 255.0f);
+            const float g = SDL_min(((p >> 16) & 0xff) * alpha + glowG, 255.0f);
+            const float b = SDL_min(((p >> 8) & 0xff) * alpha + glowB, 255.0f);
+            const float a = SDL_max(alpha * 255.0f, SDL_max(r, SDL_max(g, b)));
+            const float unpremultiply = 255.0f / a;
+            row[first + k] = ((Uint32) (r * unpremultiply + 0.5f) << 24) | ((Uint32) (g * unpremultiply + 0.5f) << 16) |
+                     ((Uint32) (b * unpremultiply + 0.5f) << 8) | (Uint32) (a + 0.5f);
+        }
+    }
+}
+
+/**
+ * Rows (columns for the vertical blur) [index * RADAR_BLOOM_JOB_ROWS, +RADAR_BLOOM_JOB_ROWS) of the current stage
+ */
+static void radar_bloom_job(void *context, int index) {
+    RadarBloom *bloom = context;
+    const RadarBloomLevel *level = &bloom->levels[bloom->level];
+    const int first = index * RADAR_BLOOM_JOB_ROWS;
+
+    switch (bloom->stage) {
+        case RADAR_BLOOM_STAGE_BRIGHT_PASS:
+            for (int y = first; y < SDL_min(first + RADAR_BLOOM_JOB_ROWS, level->height); ++y) radar_bloom_bright_pass_row(bloom, y);
+            break;
+        case RADAR_BLOOM_STAGE_DOWNSAMPLE:
+            for (int y = first; y < SDL_min(first + RADAR_BLOOM_JOB_ROWS, level->height); ++y) radar_bloom_downsample_row(bloom, y);
+            break;
+        case RADAR_BLOOM_STAGE_BLUR_ROWS:
+            for (int y = first; y < SDL_min(first + RADAR_BLOOM_JOB_ROWS, level->height); ++y) {
+                for (int c = 0; c < 3; ++c) {
+                    const size_t offset = (size_t) y * level->width;
+                    radar_bloom_blur_row(level->planes[c] + offset, level->scratch[c] + offset, level->width);
+                }
+            }
+            break;
+        case RADAR_BLOOM_STAGE_BLUR_COLUMNS:
+            for (int c = 0; c < 3; ++c) {
+                radar_bloom_blur_columns(level->scratch[c], level->planes[c], level->width, level->height,
+                                         first, SDL_min(first + RADAR_BLOOM_JOB_ROWS, level->width));
+            }
+            break;
+        case RADAR_BLOOM_STAGE_UPSAMPLE:
+            for (int y = first; y < SDL_min(first + RADAR_BLOOM_JOB_ROWS, level->height); ++y) radar_bloom_upsample_row(bloom, y);
+            break;
+        case RADAR_BLOOM_STAGE_PACK:
+            for (int y = first; y < SDL_min(first + RADAR_BLOOM_JOB_ROWS, level->height); ++y) radar_bloom_pack_row(bloom, y);
+            break;
+        case RADAR_BLOOM_STAGE_COMPOSITE:
+            for (int y = first; y < SDL_min(first + RADAR_BLOOM_JOB_ROWS, bloom->height); ++y) radar_bloom_composite_row(bloom, y);
+            break;
+    }
+}
+
+static void radar_bloom_run(RadarBloom *bloom, RadarBloomStage stage, int level, int size) {
+    bloom->stage = stage;
+    bloom->level = level;
+    radar_jobs_run(radar_bloom_job, bloom, (size + RADAR_BLOOM_JOB_ROWS - 1) / RADAR_BLOOM_JOB_ROWS);
+}
+
+/**
+ * GPU backends: add the glow texture over the scope in the current target.
+ * Color and alpha are both added (no multiplication by the texture alpha), so over opaque pixels
+ * the result is exactly the scope plus the glow.
+ */
+static void radar_bloom_composite_texture(Radar *radar, RadarBloom *bloom) {
+    const RadarBloomLevel *level = &bloom->levels[0];
+    if (bloom->texture == NULL || bloom->textureRenderer != radar->renderer) {
+        if (bloom->texture != NULL) {
+            SDL_DestroyTexture(bloom->texture);
+        }
+        bloom->texture = SDL_CreateTexture(radar->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,
+                                           level->width, level->height);
+        bloom->textureRenderer = radar->renderer;
+        if (bloom->texture == NULL) {
+            fprintf(stderr, "Could not create bloom texture: %s\n", SDL_GetError());
+            return;
+        }
+        const SDL_BlendMode additive = SDL_ComposeCustomBlendMode(
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE, SDL_BLENDOPERATION_ADD,
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE, SDL_BLENDOPERATION_ADD);
+        if (SDL_SetTextureBlendMode(bloom->texture, additive) != 0) {
+            // The software renderer has no custom blend modes, its ADD keeps the alpha of the scope
+            SDL_SetTextureBlendMode(bloom->texture, SDL_BLENDMODE_ADD);
+        }
+        SDL_SetTextureScaleMode(bloom->texture, SDL_ScaleModeLinear);
+    }
+    SDL_UpdateTexture(bloom->texture, NULL, bloom->pixels, level->width * (int) sizeof(Uint32));
+    SDL_Rect destination = radar_rectangle(radar, radar->origin.x, radar->origin.y);
+    SDL_RenderCopy(radar->renderer, bloom->texture, NULL, &destination);
+}
+
+/**
+ * Add the glow of the scope drawn so far, at the scope origin in the current target.
+ * Call it once everything is drawn and flushed.
+ */
+void radar_bloom_apply(Radar *radar) {
+    RadarBloom *bloom = radar->bloom;
+    if (bloom == NULL) return;
+
+    if (radar->backend == RADAR_BACKEND_CPU) {
+        RadarRaster *raster = radar->raster;
+        bloom->source = raster->pixels + (size_t) radar->origin.y * raster->pitch + radar->origin.x;
+        bloom->sourcePitch = raster->pitch;
+    } else {
+        // Carved from the radar arena at init, the size of the scope
+        if (radar->remapPixels == NULL) {
+            // Without the glow pass the contacts get their layered halos back
+            fprintf(stderr, "No read back buffer for the bloom, glow disabled\n");
+            radar_bloom_destroy(bloom);
+            radar->bloom = NULL;
+            return;
+        }
+        SDL_Rect scope = radar_rectangle(radar, radar->origin.x, radar->origin.y);
+        if (SDL_RenderReadPixels(radar->renderer, &scope, SDL_PIXELFORMAT_RGBA8888, radar->remapPixels,
+                                 bloom->width * (int) sizeof(Uint32)) != 0) {
+            fprintf(stderr, "Could not read the scope back for the bloom: %s\n", SDL_GetError());
+            return;
+        }
+        bloom->source = radar->remapPixels;
+        bloom->sourcePitch = bloom->width;
+    }
+
+    radar_bloom_run(bloom, RADAR_BLOOM_STAGE_BRIGHT_PASS, 0, bloom->levels[0].height);
+    for (int i = 1; i < bloom->levelCount; ++i) {
+        radar_bloom_run(bloom, RADAR_BLOOM_STAGE_DOWNSAMPLE, i, bloom->levels[i].height);
+    }
+    for (int i = 0; i < bloom->levelCount; ++i) {
+        radar_bloom_run(bloom, RADAR_BLOOM_STAGE_BLUR_ROWS, i, bloom->levels[i].height);
+        radar_bloom_run(bloom, RADAR_BLOOM_STAGE_BLUR_COLUMNS, i, bloom->levels[i].width);
+    }
+    for (int i = bloom->levelCount - 2; i >= 0; --i) {
+        radar_bloom_run(bloom, RADAR_BLOOM_STAGE_UPSAMPLE, i, bloom->levels[i].height);
+    }
+
+    if (radar->backend == RADAR_BACKEND_CPU) {
+        radar_bloom_run(bloom, RADAR_BLOOM_STAGE_COMPOSITE, 0, bloom->height);
+    } else {
+        radar_bloom_run(bloom, RADAR_BLOOM_STAGE_PACK, 0, bloom->levels[0].height);
+        radar_bloom_composite_texture(radar, bloom);
+    }
+}
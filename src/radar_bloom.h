@@ -0,0 +1,63 @@
+#ifndef RADAR_BLOOM_H
+#define RADAR_BLOOM_H
+#include <SDL2/SDL.h>
+#include "radar.h"
+
+#define RADAR_BLOOM_LEVELS 3
+#define RADAR_BLOOM_MAX_LEVELS 6
+#define RADAR_BLOOM_MIN_LEVEL_SIZE 8  // Levels stop before getting smaller than this
+#define RADAR_BLOOM_THRESHOLD 0.5f
+#define RADAR_BLOOM_INTENSITY 1.0f
+#define RADAR_BLOOM_JOB_ROWS 16       // Rows (or columns) per job
+
+typedef enum {
+    RADAR_BLOOM_STAGE_BRIGHT_PASS,
+    RADAR_BLOOM_STAGE_DOWNSAMPLE,
+    RADAR_BLOOM_STAGE_BLUR_ROWS,
+    RADAR_BLOOM_STAGE_BLUR_COLUMNS,
+    RADAR_BLOOM_STAGE_UPSAMPLE,
+    RADAR_BLOOM_STAGE_PACK,
+    RADAR_BLOOM_STAGE_COMPOSITE
+} RadarBloomStage;
+
+/**
+ * One resolution of the glow, planar float RGB
+ */
+typedef struct {
+    int width, height;
+    float *planes[3];
+    float *scratch[3]; // Output of the horizontal blur
+} RadarBloomLevel;
+
+/**
+ * Glow of the bright parts of the scope, applied after everything else is drawn.
+ * The scope is bright-passed into a half size image, halved again for each extra level, each level
+ * is blurred with a separable 5 tap binomial kernel (SSE2, four pixels at a time), and the levels
+ * are added back from the smallest up. GPU backends read the scope back and add the glow with an
+ * additive texture copy; the CPU backend adds it straight into the raster.
+ * Every stage is split in rows (columns for the vertical blur) across the radar_jobs workers.
+ * The cost depends on the scope size only, not on the number or size of the contacts.
+ * Everything but the texture is carved from the radar arena.
+ */
+struct RadarBloom {
+    RadarBloomConfig config; // Resolved, no field left to its default
+    int width, height;       // Scope size
+    RadarBloomLevel levels[RADAR_BLOOM_MAX_LEVELS];
+    int levelCount;
+    Uint32 *pixels;          // First level packed in RGBA8888 for the texture upload
+    SDL_Texture *texture;
+    SDL_Renderer *textureRenderer;
+
+    // Current stage, read by the jobs
+    RadarBloomStage stage;
+    int level;
+    Uint32 *source;          // Scope pixels, RGBA8888
+    int sourcePitch;         // In pixels
+};
+
+size_t radar_bloom_footprint(const Radar *radar);
+RadarBloom* radar_bloom_create(Radar *radar, RadarArena *arena);
+void radar_bloom_destroy(RadarBloom *bloom);
+void radar_bloom_apply(Radar *radar);
+
+#endif
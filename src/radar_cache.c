@@ -0,0 +1,439 @@
+#include "radar.h"
+#include "radar_cache.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RADAR_CACHE_MMAP 1
+#endif
+
+static RadarCacheEntry *cacheEntries = NULL;
+
+/**
+ * Cache file of the last run, mapped read only for the whole run: entries found in it point into it
+ */
+static struct {
+    char *path;
+    const Uint8 *data;
+    size_t size;
+    const RadarCacheFileRecord *records;
+    Uint32 count;
+    bool *used; // Per record, handed to an entry during this run
+} cacheFile;
+
+static const RadarCacheFileRecord* radar_cache_file_find(RadarCacheKind kind, const void *key, size_t keySize, Uint32 *index) {
+    for (Uint32 i = 0; i < cacheFile.count; ++i) {
+        const RadarCacheFileRecord *record = &cacheFile.records[i];
+        if (record->kind == (Uint32) kind && record->keySize == keySize && memcmp(record->key, key, keySize) == 0) {
+            *index = i;
+            return record;
+        }
+    }
+    return NULL;
+}
+
+RadarCacheEntry* radar_cache_acquire(RadarCacheKind kind, SDL_Renderer *renderer, const void *key, size_t keySize) {
+    if (keySize > RADAR_CACHE_KEY_SIZE) {
+        fprintf(stderr, "Radar cache key too large: %zu bytes\n", keySize);
+        return NULL;
+    }
+
+    for (RadarCacheEntry *entry = cacheEntries; entry != NULL; entry = entry->next) {
+        if (entry->kind == kind && entry->renderer == renderer &&
+            entry->keySize == keySize && memcmp(entry->key, key, keySize) == 0) {
+            entry->refCount++;
+            return entry;
+        }
+    }
+
+    RadarCacheEntry *entry = calloc(1, sizeof(RadarCacheEntry));
+    if (entry == NULL) return NULL;
+    entry->kind = kind;
+    entry->renderer = renderer;
+    memcpy(entry->key, key, keySize);
+    entry->keySize = keySize;
+    entry->refCount = 1;
+    entry->next = cacheEntries;
+    cacheEntries = entry;
+
+    Uint32 index;
+    const RadarCacheFileRecord *record = radar_cache_file_find(kind, key, keySize, &index);
+    if (record != NULL) {
+        entry->data = record->dataSize > 0 ? (void*) (cacheFile.data + record->dataOffset) : NULL;
+        entry->dataSize = record->dataSize;
+        if (record->pixelOffset != 0) {
+            entry->pixels = cacheFile.data + record->pixelOffset;
+            entry->pixelFormat = record->pixelFormat;
+            entry->pixelWidth = record->pixelWidth;
+            entry->pixelHeight = record->pixelHeight;
+        }
+        entry->mapped = true;
+        cacheFile.used[index] = true;
+    }
+    return entry;
+}
+
+void radar_cache_release(RadarCacheEntry *entry) {
+    if (entry == NULL || --entry->refCount > 0) return;
+
+    RadarCacheEntry **link = &cacheEntries;
+    while (*link != NULL && *link != entry) {
+        link = &(*link)->next;
+    }
+    if (*link == entry) {
+        *link = entry->next;
+    }
+
+    if (entry->texture != NULL) {
+        SDL_DestroyTexture(entry->texture);
+    }
+    if (!entry->mapped) {
+        free(entry->data);
+        free((void*) entry->pixels);
+    }
+    free(entry);
+}
+
+int radar_cache_entry_count(void) {
+    int count = 0;
+    for (RadarCacheEntry *entry = cacheEntries; entry != NULL; entry = entry->next) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Forget what an entry took from the cache file, which its user found unusable: the entry is then baked
+ * as if new, and the record is not written back.
+ */
+void radar_cache_drop_mapped(RadarCacheEntry *entry) {
+    if (!entry->mapped) return;
+    fprintf(stderr, "Ignoring a cache file record of another layout, baking it again\n");
+    Uint32 index;
+    if (radar_cache_file_find(entry->kind, entry->key, entry->keySize, &index) != NULL) {
+        cacheFile.used[index] = false;
+    }
+    if (entry->texture != NULL) {
+        SDL_DestroyTexture(entry->texture);
+        entry->texture = NULL;
+    }
+    entry->data = NULL;
+    entry->dataSize = 0;
+    entry->pixels = NULL;
+    entry->pixelFormat = 0;
+    entry->pixelWidth = 0;
+    entry->pixelHeight = 0;
+    entry->mapped = false;
+}
+
+/**
+ * Whether the data of an entry is there and dataSize bytes long, the size its user reads. Data from the
+ * cache file of another size (truncated, or an older layout) is dropped, see radar_cache_drop_mapped().
+ */
+bool radar_cache_has_data(RadarCacheEntry *entry, size_t dataSize) {
+    if (entry->mapped && entry->dataSize != dataSize) {
+        radar_cache_drop_mapped(entry);
+    }
+    return entry->data != NULL;
+}
+
+/**
+ * Keep a copy of the texture content of an entry for the cache file, for textures that cannot be read
+ * back (not render targets), converted to RADAR_CACHE_PIXEL_FORMAT. Nothing to do when the entry came from the file.
+ */
+bool radar_cache_keep_pixels(RadarCacheEntry *entry, const void *pixels, int pitch, Uint32 format, int width, int height) {
+    if (entry->mapped) return true;
+    const int row = (int) sizeof(Uint32) * width;
+    Uint8 *copy = malloc((size_t) row * height);
+    if (copy == NULL) return false;
+    if (SDL_ConvertPixels(width, height, format, pixels, pitch, RADAR_CACHE_PIXEL_FORMAT, copy, row) != 0) {
+        fprintf(stderr, "Could not keep a cached texture: %s\n", SDL_GetError());
+        free(copy);
+        return false;
+    }
+    free((void*) entry->pixels);
+    entry->pixels = copy;
+    entry->pixelFormat = RADAR_CACHE_PIXEL_FORMAT;
+    entry->pixelWidth = width;
+    entry->pixelHeight = height;
+    return true;
+}
+
+/**
+ * Texture of the entry, uploaded from its pixels the first time when it came from the cache file.
+ * NULL when it has neither, the entry is then baked as if new.
+ */
+SDL_Texture* radar_cache_texture(RadarCacheEntry *entry) {
+    if (entry->texture != NULL || entry->pixels == NULL || entry->renderer == NULL) return entry->texture;
+    SDL_Texture *texture = SDL_CreateTexture(entry->renderer, entry->pixelFormat, SDL_TEXTUREACCESS_STATIC,
+                                             entry->pixelWidth, entry->pixelHeight);
+    if (texture == NULL) {
+        fprintf(stderr, "Could not upload a cached texture: %s\n", SDL_GetError());
+        return NULL;
+    }
+    SDL_UpdateTexture(texture, NULL, entry->pixels, entry->pixelWidth * (int) sizeof(Uint32));
+    entry->texture = texture;
+    return texture;
+}
+
+static const void* radar_cache_map(const char *path, size_t *size) {
+#ifdef RADAR_CACHE_MMAP
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    *size = (size_t) status.st_size;
+    return data;
+#else
+    return SDL_LoadFile(path, size);
+#endif
+}
+
+static void radar_cache_unmap(const void *data, size_t size) {
+#ifdef RADAR_CACHE_MMAP
+    munmap((void*) data, size);
+#else
+    (void) size;
+    SDL_free((void*) data);
+#endif
+}
+
+static bool radar_cache_file_valid(const Uint8 *data, size_t size) {
+    RadarCacheFileHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != RADAR_CACHE_FILE_MAGIC || header.version != RADAR_CACHE_FILE_VERSION ||
+        header.count > (size - sizeof(header)) / sizeof(RadarCacheFileRecord)) {
+        return false;
+    }
+    const RadarCacheFileRecord *records = (const RadarCacheFileRecord*) (data + sizeof(header));
+    // Payloads come after the record table, never over it
+    const Uint64 payloads = sizeof(header) + (Uint64) header.count * sizeof(RadarCacheFileRecord);
+    for (Uint32 i = 0; i < header.count; ++i) {
+        const RadarCacheFileRecord *record = &records[i];
+        const Uint64 pixelSize = (Uint64) sizeof(Uint32) * (Uint32) record->pixelWidth * (Uint32) record->pixelHeight;
+        if (record->keySize > RADAR_CACHE_KEY_SIZE ||
+            record->dataOffset % RADAR_CACHE_FILE_ALIGN != 0 || record->dataOffset > size || record->dataSize > size - record->dataOffset ||
+            (record->dataSize > 0 && record->dataOffset < payloads) ||
+            record->pixelOffset % RADAR_CACHE_FILE_ALIGN != 0 || record->pixelOffset > size || pixelSize > size - record->pixelOffset ||
+            (record->pixelOffset != 0 && (record->pixelOffset < payloads || record->pixelFormat != RADAR_CACHE_PIXEL_FORMAT ||
+                                          record->pixelWidth <= 0 || record->pixelHeight <= 0))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Map the cache file of a previous run: entries acquired from now on are taken from it when their
+ * kind and key match, without being baked. The path is kept for radar_cache_save_file().
+ * Returns false, and the cache starts empty, when there is no valid file yet.
+ */
+bool radar_cache_open_file(const char *path) {
+    radar_cache_close_file();
+    cacheFile.path = malloc(strlen(path) + 1);
+    if (cacheFile.path == NULL) return false;
+    strcpy(cacheFile.path, path);
+
+    size_t size = 0;
+    const Uint8 *data = radar_cache_map(path, &size);
+    if (data == NULL) return false;
+    if (!radar_cache_file_valid(data, size)) {
+        fprintf(stderr, "Ignoring cache file %s: not a version %d cache file\n", path, RADAR_CACHE_FILE_VERSION);
+        radar_cache_unmap(data, size);
+        return false;
+    }
+    const Uint32 count = ((const RadarCacheFileHeader*) data)->count;
+    cacheFile.used = calloc(count > 0 ? count : 1, sizeof(bool));
+    if (cacheFile.used == NULL) {
+        radar_cache_unmap(data, size);
+        return false;
+    }
+    cacheFile.data = data;
+    cacheFile.size = size;
+    cacheFile.records = (const RadarCacheFileRecord*) (data + sizeof(RadarCacheFileHeader));
+    cacheFile.count = count;
+    return true;
+}
+
+/**
+ * Content of a render target texture, RADAR_CACHE_PIXEL_FORMAT
+ */
+static Uint32* radar_cache_read_texture(RadarCacheEntry *entry, int *width, int *height) {
+    Uint32 format;
+    int access;
+    if (entry->renderer == NULL || SDL_QueryTexture(entry->texture, &format, &access, width, height) != 0 ||
+        access != SDL_TEXTUREACCESS_TARGET) {
+        return NULL;
+    }
+    Uint32 *pixels = malloc(sizeof(Uint32) * *width * *height);
+    if (pixels == NULL) return NULL;
+    SDL_Texture *target = SDL_GetRenderTarget(entry->renderer);
+    SDL_SetRenderTarget(entry->renderer, entry->texture);
+    const int status = SDL_RenderReadPixels(entry->renderer, NULL, RADAR_CACHE_PIXEL_FORMAT, pixels, *width * (int) sizeof(Uint32));
+    SDL_SetRenderTarget(entry->renderer, target);
+    if (status != 0) {
+        fprintf(stderr, "Could not read back a cached texture: %s\n", SDL_GetError());
+        free(pixels);
+        return NULL;
+    }
+    return pixels;
+}
+
+typedef struct {
+    RadarCacheFileRecord record;
+    const void *data;
+    const void *pixels;
+    Uint32 *readBack; // Owned pixels
+} RadarCacheSaved;
+
+static Uint64 radar_cache_align(Uint64 offset) {
+    return (offset + RADAR_CACHE_FILE_ALIGN - 1) / RADAR_CACHE_FILE_ALIGN * RADAR_CACHE_FILE_ALIGN;
+}
+
+static bool radar_cache_write_padding(FILE *file, Uint64 *offset, Uint64 target) {
+    static const Uint8 zeros[RADAR_CACHE_FILE_ALIGN] = {0};
+    const size_t padding = (size_t) (target - *offset);
+    *offset = target;
+    return padding == 0 || fwrite(zeros, 1, padding, file) == padding;
+}
+
+/**
+ * Write the live entries, and those of the mapped file used during this run, to the cache file:
+ * the next run with the same configuration bakes nothing. Render target textures are read back,
+ * so this runs on the render thread before the radars are cleaned up. The file is replaced at once,
+ * a mapping of the previous one stays valid.
+ */
+bool radar_cache_save_file(void) {
+    if (cacheFile.path == NULL) return false;
+
+    size_t capacity = cacheFile.count;
+    for (RadarCacheEntry *entry = cacheEntries; entry != NULL; entry = entry->next) {
+        capacity++;
+    }
+    RadarCacheSaved *saved = calloc(capacity > 0 ? capacity : 1, sizeof(RadarCacheSaved));
+    if (saved == NULL) return false;
+
+    Uint32 count = 0;
+    for (RadarCacheEntry *entry = cacheEntries; entry != NULL; entry = entry->next) {
+        RadarCacheSaved *item = &saved[count];
+        *item = (RadarCacheSaved){0};
+        item->data = entry->dataSize > 0 ? entry->data : NULL;
+        item->pixels = entry->pixels;
+        item->record.pixelFormat = entry->pixelFormat;
+        item->record.pixelWidth = entry->pixelWidth;
+        item->record.pixelHeight = entry->pixelHeight;
+        if (item->pixels == NULL && entry->texture != NULL) {
+            item->readBack = radar_cache_read_texture(entry, &item->record.pixelWidth, &item->record.pixelHeight);
+            item->pixels = item->readBack;
+            item->record.pixelFormat = RADAR_CACHE_PIXEL_FORMAT;
+        }
+        if (item->data == NULL && item->pixels == NULL) continue;
+        item->record.kind = (Uint32) entry->kind;
+        item->record.keySize = (Uint32) entry->keySize;
+        memcpy(item->record.key, entry->key, entry->keySize);
+        item->record.dataSize = item->data != NULL ? entry->dataSize : 0;
+        count++;
+    }
+    for (Uint32 i = 0; i < cacheFile.count; ++i) {
+        const RadarCacheFileRecord *record = &cacheFile.records[i];
+        if (!cacheFile.used[i]) continue;
+        bool live = false;
+        for (Uint32 j = 0; j < count && !live; ++j) {
+            live = saved[j].record.kind == record->kind && saved[j].record.keySize == record->keySize &&
+                   memcmp(saved[j].record.key, record->key, record->keySize) == 0;
+        }
+        if (live) continue;
+        saved[count].record = *record;
+        saved[count].data = record->dataSize > 0 ? cacheFile.data + record->dataOffset : NULL;
+        saved[count].pixels = record->pixelOffset != 0 ? cacheFile.data + record->pixelOffset : NULL;
+        count++;
+    }
+
+    // Layout: header, records, then the payloads aligned
+    Uint64 offset = radar_cache_align(sizeof(RadarCacheFileHeader) + sizeof(RadarCacheFileRecord) * count);
+    for (Uint32 i = 0; i < count; ++i) {
+        RadarCacheFileRecord *record = &saved[i].record;
+        record->dataOffset = 0;
+        record->pixelOffset = 0;
+        if (saved[i].data != NULL) {
+            record->dataOffset = offset;
+            offset = radar_cache_align(offset + record->dataSize);
+        }
+        if (saved[i].pixels != NULL) {
+            record->pixelOffset = offset;
+            offset = radar_cache_align(offset + sizeof(Uint32) * record->pixelWidth * record->pixelHeight);
+        }
+    }
+
+    const size_t pathLength = strlen(cacheFile.path) + 5;
+    char *temporary = malloc(pathLength);
+    FILE *file = NULL;
+    if (temporary != NULL) {
+        snprintf(temporary, pathLength, "%s.tmp", cacheFile.path);
+        file = fopen(temporary, "wb");
+    }
+    bool written = file != NULL;
+    if (written) {
+        const RadarCacheFileHeader header = {RADAR_CACHE_FILE_MAGIC, RADAR_CACHE_FILE_VERSION, count, 0};
+        written = fwrite(&header, sizeof(header), 1, file) == 1;
+        Uint64 position = sizeof(header);
+        for (Uint32 i = 0; i < count && written; ++i) {
+            written = fwrite(&saved[i].record, sizeof(RadarCacheFileRecord), 1, file) == 1;
+            position += sizeof(RadarCacheFileRecord);
+        }
+        for (Uint32 i = 0; i < count && written; ++i) {
+            const RadarCacheFileRecord *record = &saved[i].record;
+            if (saved[i].data != NULL) {
+                written = radar_cache_write_padding(file, &position, record->dataOffset) &&
+                          fwrite(saved[i].data, 1, record->dataSize, file) == record->dataSize;
+                position += record->dataSize;
+            }
+            if (written && saved[i].pixels != NULL) {
+                const size_t pixelSize = sizeof(Uint32) * record->pixelWidth * record->pixelHeight;
+                written = radar_cache_write_padding(file, &position, record->pixelOffset) &&
+                          fwrite(saved[i].pixels, 1, pixelSize, file) == pixelSize;
+                position += pixelSize;
+            }
+        }
+        written = fclose(file) == 0 && written;
+#ifdef _WIN32
+        if (written) remove(cacheFile.path);
+#endif
+        written = written && rename(temporary, cacheFile.path) == 0;
+        if (!written) remove(temporary);
+    }
+    if (!written) {
+        fprintf(stderr, "Could not write cache file %s\n", cacheFile.path);
+    }
+
+    for (Uint32 i = 0; i < count; ++i) {
+        free(saved[i].readBack);
+    }
+    free(saved);
+    free(temporary);
+    return written;
+}
+
+/**
+ * Unmap the cache file, after the last entry taken from it was released
+ */
+void radar_cache_close_file(void) {
+    if (cacheFile.data != NULL) {
+        radar_cache_unmap(cacheFile.data, cacheFile.size);
+    }
+    free(cacheFile.used);
+    free(cacheFile.path);
+    memset(&cacheFile, 0, sizeof(cacheFile));
+}
@@ -0,0 +1,76 @@
+#ifndef RADAR_CACHE_H
+#define RADAR_CACHE_H
+#include <SDL2/SDL.h>
+
+#define RADAR_CACHE_KEY_SIZE 64
+#define RADAR_CACHE_FILE_MAGIC 0x48434352u // "RCCH" read in native byte order
+#define RADAR_CACHE_FILE_VERSION 2         // Bumped on any change of a key struct or of a baked payload layout
+#define RADAR_CACHE_FILE_ALIGN 64          // Payload offsets in the file
+#define RADAR_CACHE_PIXEL_FORMAT SDL_PIXELFORMAT_RGBA8888 // Of every texture content kept and saved
+
+typedef enum {
+    RADAR_CACHE_STATIC_LAYER,
+    RADAR_CACHE_STATIC_PIXELS,
+    RADAR_CACHE_REMAP,
+    RADAR_CACHE_GLYPH_ATLAS
+} RadarCacheKind;
+
+/**
+ * A baked resource shared by every radar built with the same parameters.
+ * The entry is returned empty (no texture, no data) to its first user, which is expected to fill it,
+ * unless the cache file has it: data then points into the mapped file and the texture pixels are
+ * ready for radar_cache_texture(). data must hold no pointer, it is written to the cache file as is.
+ * Entries live until the last user releases them; the registry is only used from the render thread.
+ */
+struct RadarCacheEntry {
+    struct RadarCacheEntry *next;
+    RadarCacheKind kind;
+    SDL_Renderer *renderer;
+    Uint8 key[RADAR_CACHE_KEY_SIZE];
+    size_t keySize;
+    int refCount;
+    SDL_Texture *texture;
+    void *data;
+    size_t dataSize;
+    const void *pixels;  // Texture content to upload or to save when the texture cannot be read back, NULL for none
+    Uint32 pixelFormat;
+    int pixelWidth, pixelHeight;
+    bool mapped;         // data and pixels are in the cache file, not freed with the entry
+};
+
+/**
+ * One record of the cache file, after a RadarCacheFileHeader. Payloads follow the records, each at a
+ * multiple of RADAR_CACHE_FILE_ALIGN; offsets are from the start of the file.
+ */
+typedef struct {
+    Uint32 kind;
+    Uint32 keySize;
+    Uint8 key[RADAR_CACHE_KEY_SIZE];
+    Uint64 dataOffset, dataSize;
+    Uint64 pixelOffset;  // 0 for none, pixelWidth x pixelHeight 32 bit pixels
+    Uint32 pixelFormat;  // RADAR_CACHE_PIXEL_FORMAT
+    Sint32 pixelWidth, pixelHeight;
+    Uint32 reserved;
+} RadarCacheFileRecord;
+
+typedef struct {
+    Uint32 magic;   // RADAR_CACHE_FILE_MAGIC
+    Uint32 version; // RADAR_CACHE_FILE_VERSION
+    Uint32 count;   // Records
+    Uint32 reserved;
+} RadarCacheFileHeader;
+
+RadarCacheEntry* radar_cache_acquire(RadarCacheKind kind, SDL_Renderer *renderer, const void *key, size_t keySize);
+void radar_cache_release(RadarCacheEntry *entry);
+int radar_cache_entry_count(void);
+
+bool radar_cache_has_data(RadarCacheEntry *entry, size_t dataSize);
+void radar_cache_drop_mapped(RadarCacheEntry *entry);
+bool radar_cache_keep_pixels(RadarCacheEntry *entry, const void *pixels, int pitch, Uint32 format, int width, int height);
+SDL_Texture* radar_cache_texture(RadarCacheEntry *entry);
+
+bool radar_cache_open_file(const char *path);
+bool radar_cache_save_file(void);
+void radar_cache_close_file(void);
+
+#endif
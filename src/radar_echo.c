@@ -0,0 +1,379 @@
+#include "radar_echo.h"
+#include "radar_arena.h"
+#include "radar_object.h"
+#include "radar_primitive.h"
+#include "radar_raster.h"
+#include "radar_terrain.h"
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static RadarEchoConfig radar_echo_resolve(const Radar *radar) {
+    RadarEchoConfig config = radar->echoConfig;
+    if (config.spokes <= 0) config.spokes = (int) ceil(2.0 * M_PI * radar->radius);
+    if (config.noiseLevel <= 0.0f) config.noiseLevel = RADAR_ECHO_NOISE_LEVEL;
+    if (config.clutterLevel <= 0.0f) config.clutterLevel = RADAR_ECHO_CLUTTER_LEVEL;
+    if (config.clutterRange <= 0.0f) config.clutterRange = SDL_max(radar->radius * RADAR_ECHO_CLUTTER_RANGE_RATIO, 1.0f);
+    if (config.contactGain <= 0.0f) config.contactGain = RADAR_ECHO_CONTACT_GAIN;
+    if (config.cfarGuard <= 0) config.cfarGuard = RADAR_ECHO_CFAR_GUARD;
+    if (config.cfarTraining <= 0) config.cfarTraining = RADAR_ECHO_CFAR_TRAINING;
+    if (config.cfarScale == 0.0f) config.cfarScale = RADAR_ECHO_CFAR_SCALE;
+    if (config.color.a == 0) config.color = radar->color;
+    return config;
+}
+
+/**
+ * Bytes radar_echo_create() carves from the arena
+ */
+size_t radar_echo_footprint(const Radar *radar) {
+    const RadarEchoConfig config = radar_echo_resolve(radar);
+    const size_t spokes = config.spokes;
+    const size_t bins = radar->radius;
+    const size_t pixels = (size_t) radar_width(radar) * radar_height(radar);
+    return RADAR_ARENA_FOOTPRINT(sizeof(RadarEcho)) +
+           RADAR_ARENA_FOOTPRINT(spokes * bins) +
+           RADAR_ARENA_FOOTPRINT(sizeof(float) * bins) * 2 +
+           RADAR_ARENA_FOOTPRINT(sizeof(float) * (bins + 1)) +
+           RADAR_ARENA_FOOTPRINT(sizeof(int) * (spokes + 1)) +
+           RADAR_ARENA_FOOTPRINT(sizeof(SDL_Rect) * spokes) +
+           RADAR_ARENA_FOOTPRINT(sizeof(Uint32) * pixels) * 2 +
+           RADAR_ARENA_FOOTPRINT(sizeof(Uint16) * pixels) +
+           RADAR_ARENA_FOOTPRINT(sizeof(RadarEchoTarget) * radar->max_contacts);
+}
+
+// Spoke under a bearing in degrees, any sign or number of turns
+static int radar_echo_spoke(const RadarEcho *echo, double degrees) {
+    double turns = fmod(degrees / 360.0, 1.0);
+    if (turns < 0.0) turns += 1.0;
+    int spoke = (int) (turns * echo->spokes);
+    return spoke < echo->spokes ? spoke : echo->spokes - 1;
+}
+
+RadarEcho* radar_echo_create(Radar *radar, RadarArena *arena) {
+    RadarEcho *echo = radar_arena_alloc(arena, sizeof(RadarEcho));
+    if (echo == NULL) return NULL;
+    echo->config = radar_echo_resolve(radar);
+    echo->spokes = echo->config.spokes;
+    echo->bins = radar->radius;
+    echo->width = radar_width(radar);
+    echo->height = radar_height(radar);
+
+    const size_t pixels = (size_t) echo->width * echo->height;
+    echo->video = radar_arena_alloc(arena, (size_t) echo->spokes * echo->bins);
+    echo->clutterProfile = radar_arena_alloc(arena, sizeof(float) * echo->bins);
+    echo->power = radar_arena_alloc(arena, sizeof(float) * echo->bins);
+    echo->prefix = radar_arena_alloc(arena, sizeof(float) * (echo->bins + 1));
+    echo->spokeStart = radar_arena_alloc(arena, sizeof(int) * (echo->spokes + 1));
+    echo->spokeBounds = radar_arena_alloc(arena, sizeof(SDL_Rect) * echo->spokes);
+    echo->spokePixel = radar_arena_alloc(arena, sizeof(Uint32) * pixels);
+    echo->spokeBin = radar_arena_alloc(arena, sizeof(Uint16) * pixels);
+    echo->pixels = radar_arena_alloc(arena, sizeof(Uint32) * pixels);
+    echo->targetCapacity = radar->max_contacts;
+    echo->targets = radar_arena_alloc(arena, sizeof(RadarEchoTarget) * echo->targetCapacity);
+    if (echo->video == NULL || echo->clutterProfile == NULL || echo->power == NULL || echo->prefix == NULL ||
+        echo->spokeStart == NULL || echo->spokeBounds == NULL || echo->spokePixel == NULL ||
+        echo->spokeBin == NULL || echo->pixels == NULL || (echo->targets == NULL && echo->targetCapacity > 0)) {
+        fprintf(stderr, "Could not allocate the echo buffers\n");
+        return NULL;
+    }
+
+    for (int b = 0; b < echo->bins; ++b) {
+        echo->clutterProfile[b] = echo->config.clutterLevel * expf(-(float) b / echo->config.clutterRange);
+    }
+    echo->noise[0] = 0x9E3779B9u;
+    echo->noise[1] = 0x7F4A7C15u;
+    echo->noise[2] = 0x94D049BBu;
+    echo->noise[3] = 0xBF58476Du;
+    echo->lastSpoke = -1;
+
+    // Scan conversion lists: count the pixels of each spoke, turn the counts into offsets, fill, shift back
+    const float center = (float) (radar->padding + radar->radius);
+    for (int s = 0; s < echo->spokes; ++s) {
+        echo->spokeBounds[s] = (SDL_Rect){0, 0, 0, 0};
+    }
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int y = 0; y < echo->height; ++y) {
+            for (int x = 0; x < echo->width; ++x) {
+                const float dx = x + 0.5f - center;
+                const float dy = y + 0.5f - center;
+                const float range = sqrtf(dx * dx + dy * dy);
+                if (range >= echo->bins) continue;
+                const int spoke = radar_echo_spoke(echo, atan2(dy, dx) * 180.0 / M_PI);
+                if (pass == 0) {
+                    echo->spokeStart[spoke + 1]++;
+                    SDL_Rect pixel = {x, y, 1, 1};
+                    SDL_UnionRect(&echo->spokeBounds[spoke], &pixel, &echo->spokeBounds[spoke]);
+                } else {
+                    const int k = echo->spokeStart[spoke]++;
+                    echo->spokePixel[k] = (Uint32) (y * echo->width + x);
+                    echo->spokeBin[k] = (Uint16) range;
+                }
+            }
+        }
+        if (pass == 0) {
+            for (int s = 0; s < echo->spokes; ++s) {
+                echo->spokeStart[s + 1] += echo->spokeStart[s];
+            }
+        } else {
+            for (int s = echo->spokes; s > 0; --s) {
+                echo->spokeStart[s] = echo->spokeStart[s - 1];
+            }
+            echo->spokeStart[0] = 0;
+        }
+    }
+    echo->dirty = (SDL_Rect){0, 0, echo->width, echo->height};
+    return echo;
+}
+
+/**
+ * Only the texture lives outside the arena
+ */
+void radar_echo_destroy(RadarEcho *echo) {
+    if (echo == NULL) return;
+    if (echo->texture != NULL) {
+        SDL_DestroyTexture(echo->texture);
+        echo->texture = NULL;
+    }
+}
+
+/* ---- Returns ---- */
+
+#ifdef __SSE2__
+static inline __m128i radar_echo_xorshift4(__m128i x) {
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+// Uniform in [0, 1) from the 23 high bits, through the exponent trick
+static inline __m128 radar_echo_uniform4(__m128i x) {
+    __m128i mantissa = _mm_or_si128(_mm_srli_epi32(x, 9), _mm_set1_epi32(0x3f800000));
+    return _mm_sub_ps(_mm_castsi128_ps(mantissa), _mm_set1_ps(1.0f));
+}
+#endif
+
+static inline Uint32 radar_echo_xorshift(Uint32 x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    return x ^ (x << 5);
+}
+
+static inline float radar_echo_uniform(Uint32 x) {
+    return (float) (x >> 9) * (1.0f / 8388608.0f);
+}
+
+/**
+ * Noise and clutter of a whole spoke, four bins per step: uniform noise around noiseLevel and spiky
+ * clutter (squared uniform) around the clutter profile. The scalar path draws the same lanes in the
+ * same order, so both produce the same video.
+ */
+static void radar_echo_noise(RadarEcho *echo) {
+    const float noiseScale = 2.0f * echo->config.noiseLevel;
+    float *power = echo->power;
+    int b = 0;
+#ifdef __SSE2__
+    __m128i state = _mm_loadu_si128((const __m128i *) echo->noise);
+    const __m128 noise = _mm_set1_ps(noiseScale);
+    const __m128 spike = _mm_set1_ps(3.0f);
+    for (; b + 4 <= echo->bins; b += 4) {
+        state = radar_echo_xorshift4(state);
+        __m128 u1 = radar_echo_uniform4(state);
+        state = radar_echo_xorshift4(state);
+        __m128 u2 = radar_echo_uniform4(state);
+        __m128 clutter = _mm_mul_ps(_mm_loadu_ps(echo->clutterProfile + b), _mm_mul_ps(spike, _mm_mul_ps(u2, u2)));
+        _mm_storeu_ps(power + b, _mm_add_ps(_mm_mul_ps(u1, noise), clutter));
+    }
+    _mm_storeu_si128((__m128i *) echo->noise, state);
+#endif
+    for (; b < echo->bins; b += 4) {
+        float u1[4], u2[4];
+        for (int lane = 0; lane < 4; ++lane) {
+            echo->noise[lane] = radar_echo_xorshift(echo->noise[lane]);
+            u1[lane] = radar_echo_uniform(echo->noise[lane]);
+        }
+        for (int lane = 0; lane < 4; ++lane) {
+            echo->noise[lane] = radar_echo_xorshift(echo->noise[lane]);
+            u2[lane] = radar_echo_uniform(echo->noise[lane]);
+        }
+        for (int lane = 0; lane < 4 && b + lane < echo->bins; ++lane) {
+            power[b + lane] = u1[lane] * noiseScale + echo->clutterProfile[b + lane] * (3.0f * (u2[lane] * u2[lane]));
+        }
+    }
+}
+
+/**
+ * Contacts as seen by this update, with the bearing interval they cover
+ */
+static void radar_echo_collect_targets(const Radar *radar, RadarEcho *echo) {
+    echo->targetCount = 0;
+    for (RadarObjectLinkedList *node = radar->radar_objects; node != NULL; node = node->next) {
+        const RadarObject *object = &node->object;
+        if (object->status == RADAR_OBJECT_STATUS_DEAD || object->radius <= 0) continue;
+        if (!radar_terrain_visible(radar->terrain, object->x, object->y)) continue;
+        int x, y;
+        if (!radar_object_project(radar, object, &x, &y)) continue;
+        if (echo->targetCount == echo->targetCapacity) break;
+
+        // Returns are painted on the scope: targets in scope pixels
+        RadarEchoTarget *target = &echo->targets[echo->targetCount++];
+        target->x = (float) x;
+        target->y = (float) y;
+        target->radius = (float) object->radius;
+        target->range = sqrtf(target->x * target->x + target->y * target->y);
+        target->bearing = atan2f(target->y, target->x);
+        if (target->bearing < 0.0f) target->bearing += 2.0f * (float) M_PI;
+        target->halfWidth = target->range > target->radius ? asinf(target->radius / target->range) : (float) M_PI;
+    }
+}
+
+// Range gated returns of the contacts crossing the spoke, strongest at their center
+static void radar_echo_targets(RadarEcho *echo, int spoke) {
+    const float theta = (float) ((spoke + 0.5) * 2.0 * M_PI / echo->spokes);
+    const float c = cosf(theta);
+    const float s = sinf(theta);
+    for (int t = 0; t < echo->targetCount; ++t) {
+        const RadarEchoTarget *target = &echo->targets[t];
+        float delta = fabsf(theta - target->bearing);
+        if (delta > (float) M_PI) delta = 2.0f * (float) M_PI - delta;
+        if (delta > target->halfWidth) continue;
+
+        const int first = SDL_max((int) floorf(target->range - target->radius), 0);
+        const int last = SDL_min((int) ceilf(target->range + target->radius), echo->bins - 1);
+        const float radius2 = target->radius * target->radius;
+        for (int b = first; b <= last; ++b) {
+            const float px = (b + 0.5f) * c - target->x;
+            const float py = (b + 0.5f) * s - target->y;
+            const float d2 = px * px + py * py;
+            if (d2 < radius2) {
+                echo->power[b] += echo->config.contactGain * (1.0f - d2 / radius2);
+            }
+        }
+    }
+}
+
+/**
+ * Cell averaging CFAR: each bin is compared to scale times the mean of the training bins on both sides,
+ * past the guard bins. Detections are shown with their margin over the threshold.
+ */
+static void radar_echo_detect(RadarEcho *echo, int spoke) {
+    const int bins = echo->bins;
+    const int guard = echo->config.cfarGuard;
+    const int training = echo->config.cfarTraining;
+    const float scale = echo->config.cfarScale;
+    Uint8 *video = echo->video + (size_t) spoke * bins;
+
+    if (scale < 0.0f) {
+        // Raw video
+        const float gain = 255.0f / echo->config.contactGain;
+        for (int b = 0; b < bins; ++b) {
+            video[b] = (Uint8) SDL_min(echo->power[b] * gain, 255.0f);
+        }
+        return;
+    }
+
+    echo->prefix[0] = 0.0f;
+    for (int b = 0; b < bins; ++b) {
+        echo->prefix[b + 1] = echo->prefix[b] + echo->power[b];
+    }
+    for (int b = 0; b < bins; ++b) {
+        const int leadEnd = SDL_max(b - guard, 0);
+        const int leadStart = SDL_max(b - guard - training, 0);
+        const int lagStart = SDL_min(b + guard + 1, bins);
+        const int lagEnd = SDL_min(b + guard + training + 1, bins);
+        const int count = (leadEnd - leadStart) + (lagEnd - lagStart);
+        if (count == 0) {
+            video[b] = 0;
+            continue;
+        }
+        const float sum = (echo->prefix[leadEnd] - echo->prefix[leadStart]) + (echo->prefix[lagEnd] - echo->prefix[lagStart]);
+        const float threshold = scale * sum / count;
+        const float margin = echo->power[b] - threshold;
+        video[b] = margin > 0.0f ? (Uint8) SDL_min(255.0f * margin / SDL_max(threshold, 1e-6f), 255.0f) : 0;
+    }
+}
+
+static void radar_echo_scan_convert(RadarEcho *echo, int spoke) {
+    const Uint32 rgb = RADAR_RASTER_RGBA(echo->config.color) & 0xFFFFFF00u;
+    const Uint8 *video = echo->video + (size_t) spoke * echo->bins;
+    for (int k = echo->spokeStart[spoke]; k < echo->spokeStart[spoke + 1]; ++k) {
+        echo->pixels[echo->spokePixel[k]] = rgb | video[echo->spokeBin[k]];
+    }
+    SDL_UnionRect(&echo->dirty, &echo->spokeBounds[spoke], &echo->dirty);
+}
+
+/**
+ * Rebuild the spokes crossed by the sweep since the last update
+ */
+void radar_echo_update(Radar *radar) {
+    RadarEcho *echo = radar->echo;
+    if (echo == NULL) return;
+
+    const RadarSweep *sweep = &radar->sweep;
+    const int current = radar_echo_spoke(echo, radar->angle);
+    const int step = sweep->span < 0.0 ? -1 : 1;
+    int first = current;
+    int count = 1;
+    if (echo->lastSpoke >= 0) {
+        // The swept sector, which a sector scan turning back does not end on the current spoke
+        const int from = radar_echo_spoke(echo, sweep->start);
+        const int to = radar_echo_spoke(echo, sweep->start + sweep->span);
+        count = (((to - from) * step) % echo->spokes + echo->spokes) % echo->spokes;
+        if (sweep->span >= 360.0 || sweep->span <= -360.0) {
+            count = echo->spokes; // A full turn within the frame
+        }
+        first = from + step;
+    }
+    if (count == 0) return;
+
+    radar_echo_collect_targets(radar, echo);
+    for (int i = 0; i < count; ++i) {
+        const int spoke = ((first + i * step) % echo->spokes + echo->spokes) % echo->spokes;
+        radar_echo_noise(echo);
+        radar_echo_targets(echo, spoke);
+        radar_echo_detect(echo, spoke);
+        radar_echo_scan_convert(echo, spoke);
+    }
+    echo->lastSpoke = current;
+}
+
+/**
+ * Draw the video layer at the scope origin. GPU backends upload only the part changed since the
+ * last draw; the CPU backend blends the layer straight from the echo buffer.
+ */
+void radar_echo_draw(Radar *radar) {
+    RadarEcho *echo = radar->echo;
+    if (echo == NULL) return;
+
+    if (radar->backend == RADAR_BACKEND_CPU) {
+        radar_raster_layer(radar->raster, echo->pixels, radar->origin.x, radar->origin.y, echo->width, echo->height);
+        return;
+    }
+
+    if (echo->texture == NULL || echo->textureRenderer != radar->renderer) {
+        if (echo->texture != NULL) {
+            SDL_DestroyTexture(echo->texture);
+        }
+        echo->texture = SDL_CreateTexture(radar->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,
+                                          echo->width, echo->height);
+        if (echo->texture == NULL) {
+            fprintf(stderr, "Could not create echo texture: %s\n", SDL_GetError());
+            return;
+        }
+        SDL_SetTextureBlendMode(echo->texture, SDL_BLENDMODE_BLEND);
+        echo->textureRenderer = radar->renderer;
+        echo->dirty = (SDL_Rect){0, 0, echo->width, echo->height};
+    }
+    if (!SDL_RectEmpty(&echo->dirty)) {
+        const Uint32 *first = echo->pixels + (size_t) echo->dirty.y * echo->width + echo->dirty.x;
+        SDL_UpdateTexture(echo->texture, &echo->dirty, first, echo->width * (int) sizeof(Uint32));
+        echo->dirty = (SDL_Rect){0, 0, 0, 0};
+    }
+
+    radar_primitive_flush(radar);
+    SDL_Rect destination = radar_rectangle(radar, radar->origin.x, radar->origin.y);
+    SDL_RenderCopy(radar->renderer, echo->texture, NULL, &destination);
+}
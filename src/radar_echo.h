@@ -0,0 +1,62 @@
+#ifndef RADAR_ECHO_H
+#define RADAR_ECHO_H
+#include <SDL2/SDL.h>
+#include "radar.h"
+
+#define RADAR_ECHO_NOISE_LEVEL 1.0f
+#define RADAR_ECHO_CLUTTER_LEVEL 6.0f
+#define RADAR_ECHO_CLUTTER_RANGE_RATIO 0.125f // Default clutter range, as a fraction of the bins
+#define RADAR_ECHO_CONTACT_GAIN 12.0f
+#define RADAR_ECHO_CFAR_GUARD 24 // Wider than the contacts, so they do not raise their own threshold
+#define RADAR_ECHO_CFAR_TRAINING 16
+#define RADAR_ECHO_CFAR_SCALE 2.5f
+
+/**
+ * A contact seen by the echo engine during one update
+ */
+typedef struct {
+    float x, y;      // Relative to the scope center
+    float radius;
+    float range;
+    float bearing;   // Radians in [0, 2pi), same convention as radar->angle
+    float halfWidth; // Half of the bearing interval covered by the contact
+} RadarEchoTarget;
+
+/**
+ * Simulated raw video: a bearing x range-bin intensity array, rewritten one spoke at a time as the sweep
+ * crosses it. Each spoke gets receiver noise and sea clutter, range gated contact returns and a
+ * cell averaging CFAR detection, then is scan converted into the scope through a precomputed list of the
+ * pixels it covers. The work per frame is proportional to the spokes swept, not to the image.
+ * Everything but the texture is carved from the radar arena.
+ */
+struct RadarEcho {
+    RadarEchoConfig config; // Resolved, no field left to its default
+    int spokes;
+    int bins;
+    int width, height;      // Scope size of the video layer
+    Uint8 *video;           // spokes x bins detected intensity
+    float *clutterProfile;  // Mean clutter power per bin
+    float *power;           // Returns of the spoke being built
+    float *prefix;          // bins + 1 running sums of power, for the CFAR windows
+    Uint32 noise[4];        // xorshift32 state, one lane per SIMD lane
+    int *spokeStart;        // spokes + 1 offsets in spokePixel and spokeBin
+    Uint32 *spokePixel;     // Scope pixels of each spoke, grouped by spoke
+    Uint16 *spokeBin;       // Range bin of each of these pixels
+    SDL_Rect *spokeBounds;  // Bounding box of the pixels of each spoke
+    Uint32 *pixels;         // Scan converted video layer, RGBA8888 width x height
+    SDL_Rect dirty;         // Part of pixels changed since the last upload
+    int lastSpoke;          // Last spoke written, -1 before the first update
+    RadarEchoTarget *targets;
+    int targetCount;
+    int targetCapacity;
+    SDL_Texture *texture;
+    SDL_Renderer *textureRenderer;
+};
+
+size_t radar_echo_footprint(const Radar *radar);
+RadarEcho* radar_echo_create(Radar *radar, RadarArena *arena);
+void radar_echo_destroy(RadarEcho *echo);
+void radar_echo_update(Radar *radar);
+void radar_echo_draw(Radar *radar);
+
+#endif
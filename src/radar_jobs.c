@@ -0,0 +1,137 @@
+#include "radar_jobs.h"
+#include <SDL2/SDL.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+static struct {
+    bool started;
+    bool quit;
+    int threadCount;
+    SDL_Thread *threads[RADAR_JOBS_MAX_THREADS];
+    SDL_mutex *mutex;
+    SDL_cond *startCond;
+    SDL_cond *doneCond;
+    Uint64 generation;
+    int activeWorkers;
+    RadarJobFunction function;
+    void *context;
+    int count;
+    atomic_int next;
+} pool;
+
+static void radar_jobs_run_batch(void) {
+    int index;
+    while ((index = atomic_fetch_add(&pool.next, 1)) < pool.count) {
+        pool.function(pool.context, index);
+    }
+}
+
+static int radar_jobs_worker(void *data) {
+    (void) data;
+    Uint64 seenGeneration = 0;
+
+    SDL_LockMutex(pool.mutex);
+    while (true) {
+        while (!pool.quit && pool.generation == seenGeneration) {
+            SDL_CondWait(pool.startCond, pool.mutex);
+        }
+        if (pool.quit) break;
+        seenGeneration = pool.generation;
+        SDL_UnlockMutex(pool.mutex);
+
+        radar_jobs_run_batch();
+
+        SDL_LockMutex(pool.mutex);
+        if (--pool.activeWorkers == 0) {
+            SDL_CondSignal(pool.doneCond);
+        }
+    }
+    SDL_UnlockMutex(pool.mutex);
+    return 0;
+}
+
+static void radar_jobs_start(void) {
+    pool.started = true;
+    pool.mutex = SDL_CreateMutex();
+    pool.startCond = SDL_CreateCond();
+    pool.doneCond = SDL_CreateCond();
+    if (pool.mutex == NULL || pool.startCond == NULL || pool.doneCond == NULL) {
+        fprintf(stderr, "Radar jobs: could not create the pool, running single threaded: %s\n", SDL_GetError());
+        return;
+    }
+
+    int workers = SDL_GetCPUCount() - 1;
+    if (workers > RADAR_JOBS_MAX_THREADS) workers = RADAR_JOBS_MAX_THREADS;
+    for (int i = 0; i < workers; ++i) {
+        pool.threads[pool.threadCount] = SDL_CreateThread(radar_jobs_worker, "RadarJobs", NULL);
+        if (pool.threads[pool.threadCount] == NULL) {
+            fprintf(stderr, "Radar jobs: could not create worker: %s\n", SDL_GetError());
+            break;
+        }
+        pool.threadCount++;
+    }
+}
+
+void radar_jobs_run(RadarJobFunction function, void *context, int count) {
+    if (count <= 0) return;
+    if (!pool.started) {
+        radar_jobs_start();
+    }
+
+    if (pool.threadCount == 0 || count == 1) {
+        for (int i = 0; i < count; ++i) {
+            function(context, i);
+        }
+        return;
+    }
+
+    SDL_LockMutex(pool.mutex);
+    pool.function = function;
+    pool.context = context;
+    pool.count = count;
+    atomic_store(&pool.next, 0);
+    pool.activeWorkers = pool.threadCount;
+    pool.generation++;
+    SDL_CondBroadcast(pool.startCond);
+    SDL_UnlockMutex(pool.mutex);
+
+    radar_jobs_run_batch();
+
+    SDL_LockMutex(pool.mutex);
+    while (pool.activeWorkers > 0) {
+        SDL_CondWait(pool.doneCond, pool.mutex);
+    }
+    SDL_UnlockMutex(pool.mutex);
+}
+
+int radar_jobs_thread_count(void) {
+    if (!pool.started) {
+        radar_jobs_start();
+    }
+    return pool.threadCount + 1;
+}
+
+void radar_jobs_shutdown(void) {
+    if (!pool.started) return;
+
+    if (pool.mutex != NULL) {
+        SDL_LockMutex(pool.mutex);
+        pool.quit = true;
+        SDL_CondBroadcast(pool.startCond);
+        SDL_UnlockMutex(pool.mutex);
+    }
+    for (int i = 0; i < pool.threadCount; ++i) {
+        SDL_WaitThread(pool.threads[i], NULL);
+    }
+    if (pool.doneCond != NULL) SDL_DestroyCond(pool.doneCond);
+    if (pool.startCond != NULL) SDL_DestroyCond(pool.startCond);
+    if (pool.mutex != NULL) SDL_DestroyMutex(pool.mutex);
+
+    pool.started = false;
+    pool.quit = false;
+    pool.threadCount = 0;
+    pool.mutex = NULL;
+    pool.startCond = NULL;
+    pool.doneCond = NULL;
+}
@@ -0,0 +1,17 @@
+#ifndef RADAR_JOBS_H
+#define RADAR_JOBS_H
+
+#define RADAR_JOBS_MAX_THREADS 32
+
+typedef void (*RadarJobFunction)(void *context, int index);
+
+/**
+ * Process wide worker pool. radar_jobs_run() calls function(context, i) for every i in [0, count)
+ * across the workers and the calling thread, and returns once all of them are done.
+ * The pool starts on first use with one worker per extra CPU core.
+ */
+void radar_jobs_run(RadarJobFunction function, void *context, int count);
+int radar_jobs_thread_count(void);
+void radar_jobs_shutdown(void);
+
+#endif
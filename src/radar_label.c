@@ -0,0 +1,404 @@
+#include "radar_label.h"
+#include "radar_batch.h"
+#include "radar_cache.h"
+#include "radar_object.h"
+#include "radar_terrain.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <SDL2_gfxPrimitives.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define RADAR_LABEL_FALLBACK_GLYPH 8 // SDL2_gfx font cell
+#define RADAR_LABEL_RING_STEP 100    // Same rings as radar_draw_circles()
+
+static const SDL_Color RADAR_LABEL_ENEMY_COLOR = {255, 120, 120, 230};
+static const SDL_Color RADAR_LABEL_ALLY_COLOR = {150, 220, 255, 230};
+
+static const char* radar_label_type_name(int type) {
+    switch (type) {
+        case ENEMY_DEFAULT: return "HOS";
+        case ENEMY_DRONE: return "DRN";
+        case ENEMY_TANK: return "TNK";
+        case ENEMY_BOMBER: return "BMB";
+        case ENEMY_SNIPER: return "SNP";
+        case ENEMY_ARTILLERY: return "ART";
+        case ENEMY_ARMORED: return "ARM";
+        case ENEMY_BOSSES: return "BOS";
+        case ALLY_DEFAULT: return "FRD";
+        case ALLY_SCOUT: return "SCT";
+        case ALLY_MEDIC: return "MED";
+        case ALLY_TANKER: return "TKR";
+        case ALLY_SNIPER_SUPPORT: return "SUP";
+        case ALLY_TECHNICIAN: return "TEC";
+        case ALLY_DRONE: return "UAV";
+        case ALLY_COMMANDER: return "CMD";
+        default: return "UNK";
+    }
+}
+
+static const SDL_Rect* radar_label_glyph(const RadarGlyphAtlas *atlas, char c) {
+    int index = (unsigned char) c - RADAR_LABEL_FIRST_GLYPH;
+    if (index < 0 || index >= RADAR_LABEL_GLYPHS) index = '?' - RADAR_LABEL_FIRST_GLYPH;
+    return &atlas->glyphs[index];
+}
+
+/**
+ * Rasterize the glyphs of a TrueType font into one surface, row after row, and upload it.
+ * The surface is kept in the cache entry for the cache file, the texture cannot be read back.
+ */
+static SDL_Texture* radar_label_bake_ttf(RadarCacheEntry *entry, const char *path, int size, RadarGlyphAtlas *atlas) {
+    if (!TTF_WasInit() && TTF_Init() < 0) {
+        fprintf(stderr, "Labels: could not initialize SDL2_ttf: %s\n", SDL_GetError());
+        return NULL;
+    }
+    TTF_Font *font = TTF_OpenFont(path, size);
+    if (font == NULL) {
+        fprintf(stderr, "Labels: could not open font %s: %s\n", path, SDL_GetError());
+        return NULL;
+    }
+
+    SDL_Surface *glyphs[RADAR_LABEL_GLYPHS] = {0};
+    const int lineHeight = TTF_FontHeight(font);
+    int x = 0;
+    int y = 0;
+    for (int i = 0; i < RADAR_LABEL_GLYPHS; ++i) {
+        glyphs[i] = TTF_RenderGlyph_Blended(font, (Uint16) (RADAR_LABEL_FIRST_GLYPH + i), (SDL_Color){255, 255, 255, 255});
+        const int width = glyphs[i] != NULL ? glyphs[i]->w : 0;
+        if (x + width > RADAR_LABEL_ATLAS_WIDTH) {
+            x = 0;
+            y += lineHeight;
+        }
+        atlas->glyphs[i] = (SDL_Rect){x, y, width, lineHeight};
+        x += width;
+    }
+    TTF_CloseFont(font);
+    atlas->lineHeight = lineHeight;
+    atlas->width = RADAR_LABEL_ATLAS_WIDTH;
+    atlas->height = y + lineHeight;
+
+    SDL_Texture *texture = NULL;
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, atlas->width, atlas->height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (surface != NULL) {
+        SDL_FillRect(surface, NULL, 0);
+        for (int i = 0; i < RADAR_LABEL_GLYPHS; ++i) {
+            if (glyphs[i] == NULL) continue;
+            // Copy the coverage as is, the vertex colors tint it
+            SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+            SDL_Rect destination = atlas->glyphs[i];
+            SDL_BlitSurface(glyphs[i], NULL, surface, &destination);
+        }
+        texture = SDL_CreateTextureFromSurface(entry->renderer, surface);
+        if (texture != NULL) {
+            radar_cache_keep_pixels(entry, surface->pixels, surface->pitch, surface->format->format, surface->w, surface->h);
+        }
+        SDL_FreeSurface(surface);
+    }
+    for (int i = 0; i < RADAR_LABEL_GLYPHS; ++i) {
+        SDL_FreeSurface(glyphs[i]);
+    }
+    if (texture == NULL) {
+        fprintf(stderr, "Labels: could not create the glyph atlas: %s\n", SDL_GetError());
+    }
+    return texture;
+}
+
+/**
+ * Draw the SDL2_gfx built-in 8x8 font in a render target, 16 glyphs per row
+ */
+static SDL_Texture* radar_label_bake_fallback(SDL_Renderer *renderer, RadarGlyphAtlas *atlas) {
+    const int columns = 16;
+    const int rows = (RADAR_LABEL_GLYPHS + columns - 1) / columns;
+    atlas->lineHeight = RADAR_LABEL_FALLBACK_GLYPH;
+    atlas->width = columns * RADAR_LABEL_FALLBACK_GLYPH;
+    atlas->height = rows * RADAR_LABEL_FALLBACK_GLYPH;
+    atlas->fallback = true;
+
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                             atlas->width, atlas->height);
+    if (texture == NULL) {
+        fprintf(stderr, "Labels: could not create the glyph atlas: %s\n", SDL_GetError());
+        return NULL;
+    }
+    SDL_Texture *previousTarget = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, texture);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    for (int i = 0; i < RADAR_LABEL_GLYPHS; ++i) {
+        const int x = (i % columns) * RADAR_LABEL_FALLBACK_GLYPH;
+        const int y = (i / columns) * RADAR_LABEL_FALLBACK_GLYPH;
+        atlas->glyphs[i] = (SDL_Rect){x, y, RADAR_LABEL_FALLBACK_GLYPH, RADAR_LABEL_FALLBACK_GLYPH};
+        characterRGBA(renderer, (Sint16) x, (Sint16) y, (char) (RADAR_LABEL_FIRST_GLYPH + i), 255, 255, 255, 255);
+    }
+    SDL_SetRenderTarget(renderer, previousTarget);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    return texture;
+}
+
+/**
+ * Whether an atlas from the cache file fits the texture kept with it: same size, every glyph inside
+ */
+static bool radar_label_atlas_valid(const RadarGlyphAtlas *atlas, const RadarCacheEntry *entry) {
+    if (atlas->width <= 0 || atlas->height <= 0 || atlas->lineHeight <= 0 ||
+        atlas->width != entry->pixelWidth || atlas->height != entry->pixelHeight) {
+        return false;
+    }
+    for (int i = 0; i < RADAR_LABEL_GLYPHS; ++i) {
+        const SDL_Rect *glyph = &atlas->glyphs[i];
+        if (glyph->x < 0 || glyph->y < 0 || glyph->w < 0 || glyph->h < 0 ||
+            glyph->w > atlas->width - glyph->x || glyph->h > atlas->height - glyph->y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Glyph atlas of the radar font, baked on first use and shared through the cache.
+ * The font comes from radar->label_font, RADAR_FONT or RADAR_LABEL_DEFAULT_FONT, in that order,
+ * and falls back to the SDL2_gfx font when none can be opened.
+ */
+static const RadarGlyphAtlas* radar_label_atlas(Radar *radar) {
+    RadarLabels *labels = radar->labels;
+    if (labels->atlas == NULL) {
+        const char *path = radar->label_font;
+        if (path == NULL) path = getenv("RADAR_FONT");
+        if (path == NULL) path = RADAR_LABEL_DEFAULT_FONT;
+        const int size = radar->label_size > 0 ? radar->label_size : RADAR_LABEL_DEFAULT_SIZE;
+
+        // FNV-1a of the path, the key has no room for the path itself; the file size and time tell a changed font
+        struct {
+            Uint32 pathHash;
+            int size;
+            Sint64 fileSize;
+            Sint64 modified;
+        } key;
+        memset(&key, 0, sizeof(key));
+        key.pathHash = 2166136261u;
+        for (const char *c = path; *c != '\0'; ++c) {
+            key.pathHash = (key.pathHash ^ (Uint8) *c) * 16777619u;
+        }
+        key.size = size;
+        struct stat status;
+        if (stat(path, &status) == 0) {
+            key.fileSize = (Sint64) status.st_size;
+            key.modified = (Sint64) status.st_mtime;
+        }
+
+        labels->atlas = radar_cache_acquire(RADAR_CACHE_GLYPH_ATLAS, radar->renderer, &key, sizeof(key));
+        if (labels->atlas == NULL) return NULL;
+        if (labels->atlas->mapped && (!radar_cache_has_data(labels->atlas, sizeof(RadarGlyphAtlas)) ||
+                                      !radar_label_atlas_valid(labels->atlas->data, labels->atlas))) {
+            radar_cache_drop_mapped(labels->atlas);
+        }
+        if (labels->atlas->data == NULL) {
+            RadarGlyphAtlas *atlas = calloc(1, sizeof(RadarGlyphAtlas));
+            if (atlas == NULL) return NULL;
+            labels->atlas->texture = radar_label_bake_ttf(labels->atlas, path, size, atlas);
+            if (labels->atlas->texture == NULL) {
+                memset(atlas, 0, sizeof(RadarGlyphAtlas));
+                labels->atlas->texture = radar_label_bake_fallback(radar->renderer, atlas);
+            }
+            if (labels->atlas->texture != NULL) {
+                SDL_SetTextureBlendMode(labels->atlas->texture, SDL_BLENDMODE_BLEND);
+            }
+            labels->atlas->data = atlas;
+            labels->atlas->dataSize = sizeof(RadarGlyphAtlas);
+        } else if (labels->atlas->texture == NULL && radar_cache_texture(labels->atlas) != NULL) {
+            // From the cache file
+            SDL_SetTextureBlendMode(labels->atlas->texture, SDL_BLENDMODE_BLEND);
+        }
+    }
+    return labels->atlas->texture != NULL ? labels->atlas->data : NULL;
+}
+
+static void radar_label_measure(RadarLabelText *label, const RadarGlyphAtlas *atlas) {
+    label->width = 0;
+    for (int i = 0; i < label->length; ++i) {
+        label->width += radar_label_glyph(atlas, label->text[i])->w;
+    }
+}
+
+/**
+ * Rebuild the text of a contact label when the contact or one of its rounded values changed.
+ * Returns true when it did.
+ */
+static bool radar_label_refresh(RadarLabelText *label, Uint32 id, const RadarObject *object, const RadarGlyphAtlas *atlas) {
+    const int range = (int) lround(sqrt(object->x * object->x + object->y * object->y));
+    int bearing = (int) lround(atan2(object->x, -object->y) * 180.0 / M_PI);
+    if (bearing < 0) bearing += 360;
+    if (bearing >= 360) bearing -= 360;
+    if (label->id == id && label->type == object->type && label->range == range && label->bearing == bearing) {
+        return false;
+    }
+
+    label->id = id;
+    label->type = object->type;
+    label->range = range;
+    label->bearing = bearing;
+    label->length = snprintf(label->text, sizeof(label->text), "%s %d/%03d", radar_label_type_name(object->type), range, bearing);
+    label->length = SDL_min(label->length, RADAR_LABEL_MAX_LENGTH - 1);
+    radar_label_measure(label, atlas);
+    return true;
+}
+
+/**
+ * Reserve the occupancy cells under a label, false (nothing reserved) when one is already taken
+ */
+static bool radar_label_place(RadarLabels *labels, int x, int y, int width, int height) {
+    if (x < 0 || y < 0 || x + width > labels->occupancyColumns * RADAR_LABEL_CELL ||
+        y + height > labels->occupancyRows * RADAR_LABEL_CELL) {
+        return false; // Outside of the scope
+    }
+    const int firstColumn = x / RADAR_LABEL_CELL;
+    const int lastColumn = (x + width - 1) / RADAR_LABEL_CELL;
+    const int firstRow = y / RADAR_LABEL_CELL;
+    const int lastRow = (y + height - 1) / RADAR_LABEL_CELL;
+    for (int row = firstRow; row <= lastRow; ++row) {
+        const Uint8 *cells = labels->occupancy + row * labels->occupancyColumns;
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            if (cells[column]) return false;
+        }
+    }
+    for (int row = firstRow; row <= lastRow; ++row) {
+        memset(labels->occupancy + row * labels->occupancyColumns + firstColumn, 1, lastColumn - firstColumn + 1);
+    }
+    return true;
+}
+
+static void radar_label_emit(RadarLabels *labels, const RadarGlyphAtlas *atlas, const RadarLabelText *label,
+                             float x, float y, SDL_Color color) {
+    const float uScale = 1.0f / atlas->width;
+    const float vScale = 1.0f / atlas->height;
+    for (int i = 0; i < label->length; ++i) {
+        const SDL_Rect *glyph = radar_label_glyph(atlas, label->text[i]);
+        radar_batch_textured_quad(labels->batch, x, y, x + glyph->w, y + glyph->h,
+            glyph->x * uScale, glyph->y * vScale, (glyph->x + glyph->w) * uScale, (glyph->y + glyph->h) * vScale, color);
+        x += glyph->w;
+    }
+}
+
+RadarLabels* radar_labels_create(const Radar *radar) {
+    RadarLabels *labels = calloc(1, sizeof(RadarLabels));
+    if (labels == NULL) {
+        fprintf(stderr, "Could not allocate the labels\n");
+        return NULL;
+    }
+    labels->textCount = radar->contactPool.capacity;
+    labels->texts = calloc(SDL_max(labels->textCount, 1), sizeof(RadarLabelText));
+    labels->occupancyColumns = (radar_width(radar) + RADAR_LABEL_CELL - 1) / RADAR_LABEL_CELL;
+    labels->occupancyRows = (radar_height(radar) + RADAR_LABEL_CELL - 1) / RADAR_LABEL_CELL;
+    labels->occupancy = malloc((size_t) labels->occupancyColumns * labels->occupancyRows);
+    labels->batch = radar_batch_create();
+    if (labels->texts == NULL || labels->occupancy == NULL || labels->batch == NULL) {
+        fprintf(stderr, "Could not allocate the labels\n");
+        radar_labels_destroy(labels);
+        return NULL;
+    }
+
+    // Ring texts follow the zoom, they are built on the first draw
+    for (int r = radar->radius; r > 0 && labels->ringCount < RADAR_LABEL_MAX_RINGS; r -= RADAR_LABEL_RING_STEP) {
+        labels->rings[labels->ringCount++].range = -1;
+    }
+    return labels;
+}
+
+void radar_labels_destroy(RadarLabels *labels) {
+    if (labels == NULL) return;
+    radar_cache_release(labels->atlas);
+    radar_batch_destroy(labels->batch);
+    free(labels->occupancy);
+    free(labels->texts);
+    free(labels);
+}
+
+/**
+ * Draw the labels over the scope shown at radar->destination in the current render target.
+ * Ring labels are placed first, then enemy labels, then the others; each is culled when it would
+ * overlap a label already placed or leave the scope.
+ */
+void radar_labels_draw(Radar *radar) {
+    RadarLabels *labels = radar->labels;
+    if (labels == NULL) return;
+    const RadarGlyphAtlas *atlas = radar_label_atlas(radar);
+    if (atlas == NULL) return;
+
+    labels->drawn = 0;
+    labels->culled = 0;
+    labels->regenerated = 0;
+    memset(labels->occupancy, 0, (size_t) labels->occupancyColumns * labels->occupancyRows);
+
+    const int center = radar->padding + radar->radius; // In the scope, labels are placed before scaling
+    const float scaleX = (float) radar->destination.w / radar_width(radar);
+    const float scaleY = (float) radar->destination.h / radar_height(radar);
+    const int lineHeight = atlas->lineHeight;
+
+    for (int i = 0; i < labels->ringCount; ++i) {
+        RadarLabelText *ring = &labels->rings[i];
+        const int pixels = radar->radius - i * RADAR_LABEL_RING_STEP;
+        // Range from the antenna of the point the label sits on, like the contact labels, even when panned
+        const int range = (int) lround(hypot(radar->view.centerX, radar->view.centerY - pixels / radar->view.scale));
+        if (ring->range != range) {
+            ring->range = range;
+            ring->length = SDL_min(snprintf(ring->text, sizeof(ring->text), "%d", range), RADAR_LABEL_MAX_LENGTH - 1);
+            radar_label_measure(ring, atlas);
+            labels->regenerated++;
+        }
+        const int x = center + 3;
+        const int y = center - pixels + 2;
+        if (radar_label_place(labels, x, y, ring->width, lineHeight)) {
+            radar_label_emit(labels, atlas, ring, radar->destination.x + x * scaleX, radar->destination.y + y * scaleY, radar->color);
+            labels->drawn++;
+        } else {
+            labels->culled++;
+        }
+    }
+
+    // Refresh the texts and drop every contact label when together they would crowd the scope
+    const RadarObjectLinkedList *nodes = radar->contactPool.nodes;
+    float coverage = 0.0f;
+    int contacts = 0;
+    for (const RadarObjectLinkedList *node = radar->radar_objects; node != NULL; node = node->next) {
+        const int slot = (int) (node - nodes);
+        if (node->object.status != RADAR_OBJECT_STATUS_ALIVE || slot < 0 || slot >= labels->textCount) continue;
+        if (!radar_terrain_visible(radar->terrain, node->object.x, node->object.y)) continue;
+        int scopeX, scopeY;
+        if (!radar_object_project(radar, &node->object, &scopeX, &scopeY)) continue;
+        RadarLabelText *label = &labels->texts[slot];
+        if (radar_label_refresh(label, node->id, &node->object, atlas)) labels->regenerated++;
+        coverage += (float) label->width * lineHeight;
+        contacts++;
+    }
+    if (coverage > RADAR_LABEL_MAX_COVERAGE * radar_width(radar) * radar_height(radar)) {
+        labels->culled += contacts;
+    } else {
+        for (int pass = 0; pass < 2; ++pass) {
+            for (const RadarObjectLinkedList *node = radar->radar_objects; node != NULL; node = node->next) {
+                const int slot = (int) (node - nodes);
+                const RadarObject *object = &node->object;
+                if (object->status != RADAR_OBJECT_STATUS_ALIVE || slot < 0 || slot >= labels->textCount) continue;
+                if ((pass == 0) != (object->type < 0)) continue;
+                if (!radar_terrain_visible(radar->terrain, object->x, object->y)) continue;
+                int scopeX, scopeY;
+                if (!radar_object_project(radar, object, &scopeX, &scopeY)) continue;
+
+                const RadarLabelText *label = &labels->texts[slot];
+                const int x = center + scopeX + object->radius + 2;
+                const int y = center + scopeY - lineHeight / 2;
+                if (!radar_label_place(labels, x, y, label->width, lineHeight)) {
+                    labels->culled++;
+                    continue;
+                }
+                radar_label_emit(labels, atlas, label, radar->destination.x + x * scaleX, radar->destination.y + y * scaleY,
+                                 object->type < 0 ? RADAR_LABEL_ENEMY_COLOR : RADAR_LABEL_ALLY_COLOR);
+                labels->drawn++;
+            }
+        }
+    }
+
+    radar_batch_flush_texture(labels->batch, radar->renderer, labels->atlas->texture);
+}
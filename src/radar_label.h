@@ -0,0 +1,64 @@
+#ifndef RADAR_LABEL_H
+#define RADAR_LABEL_H
+#include <SDL2/SDL.h>
+#include "radar.h"
+
+#define RADAR_LABEL_DEFAULT_FONT "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf"
+#define RADAR_LABEL_DEFAULT_SIZE 12
+#define RADAR_LABEL_FIRST_GLYPH 32     // Printable ASCII only, other characters are drawn as '?'
+#define RADAR_LABEL_GLYPHS 95
+#define RADAR_LABEL_ATLAS_WIDTH 256
+#define RADAR_LABEL_MAX_LENGTH 24
+#define RADAR_LABEL_MAX_RINGS 32
+#define RADAR_LABEL_CELL 4             // Occupancy grid resolution in pixels
+#define RADAR_LABEL_MAX_COVERAGE 0.25f // Contact labels are dropped when they would cover more of the scope
+
+/**
+ * Printable ASCII rendered once in a texture, shared through the radar cache by the radars using
+ * the same font on a renderer. Glyphs all have the line height and advance by their width.
+ */
+typedef struct {
+    SDL_Rect glyphs[RADAR_LABEL_GLYPHS];
+    int lineHeight;
+    int width, height; // Texture size
+    bool fallback;     // Built from the SDL2_gfx 8x8 font, no TrueType font could be loaded
+} RadarGlyphAtlas;
+
+/**
+ * Text of a label, rebuilt only when the rounded values it shows change
+ */
+typedef struct {
+    Uint32 id;    // Contact the text was built for, 0 for none
+    int type;
+    int range;    // World units from the antenna
+    int bearing;  // Degrees clockwise from north
+    int length;
+    int width;    // Pixels, with the atlas advances
+    char text[RADAR_LABEL_MAX_LENGTH];
+} RadarLabelText;
+
+/**
+ * Type, range and bearing next to each contact and the range of each ring, drawn over the scope
+ * after radar_render() with a single SDL_RenderGeometry on the glyph atlas.
+ * Labels overlapping an already placed one are culled (enemies are placed first), and contact
+ * labels are all dropped when together they would cover too much of the scope.
+ */
+struct RadarLabels {
+    RadarCacheEntry *atlas;
+    RadarLabelText *texts;   // One per contact pool slot
+    int textCount;
+    RadarLabelText rings[RADAR_LABEL_MAX_RINGS];
+    int ringCount;
+    RadarBatch *batch;
+    Uint8 *occupancy;
+    int occupancyColumns, occupancyRows;
+    int drawn;       // Labels drawn by the last radar_labels_draw()
+    int culled;      // Labels culled by the last radar_labels_draw()
+    int regenerated; // Texts rebuilt by the last radar_labels_draw()
+};
+
+RadarLabels* radar_labels_create(const Radar *radar);
+void radar_labels_destroy(RadarLabels *labels);
+void radar_labels_draw(Radar *radar);
+
+#endif
@@ -0,0 +1,156 @@
+#include "radar_metrics.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RADAR_METRICS_SHM 1
+#endif
+
+/**
+ * Create (or take over, after a crash) the segment and fill its header.
+ * Returns NULL where POSIX shared memory is not available.
+ */
+RadarMetrics* radar_metrics_create(const char *name) {
+#ifdef RADAR_METRICS_SHM
+    if (name == NULL) name = RADAR_METRICS_DEFAULT_NAME;
+    RadarMetrics *metrics = calloc(1, sizeof(RadarMetrics));
+    if (metrics == NULL) return NULL;
+    snprintf(metrics->name, sizeof(metrics->name), "%s", name);
+
+    const int fd = shm_open(metrics->name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Could not create metrics segment %s: %s\n", metrics->name, strerror(errno));
+        free(metrics);
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(RadarMetricsSegment)) != 0) {
+        fprintf(stderr, "Could not size metrics segment %s: %s\n", metrics->name, strerror(errno));
+        close(fd);
+        shm_unlink(metrics->name);
+        free(metrics);
+        return NULL;
+    }
+    metrics->segment = mmap(NULL, sizeof(RadarMetricsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (metrics->segment == MAP_FAILED) {
+        fprintf(stderr, "Could not map metrics segment %s: %s\n", metrics->name, strerror(errno));
+        shm_unlink(metrics->name);
+        free(metrics);
+        return NULL;
+    }
+    metrics->owner = true;
+
+    // Readers check the header before anything else: keep it invalid until the data is cleared
+    RadarMetricsSegment *segment = metrics->segment;
+    atomic_store_explicit(&segment->sequence, 1, memory_order_relaxed);
+    segment->magic = 0;
+    atomic_thread_fence(memory_order_release);
+    memset(&segment->data, 0, sizeof(segment->data));
+    segment->version = RADAR_METRICS_VERSION;
+    segment->size = sizeof(RadarMetricsSegment);
+    segment->pid = (Uint32) getpid();
+    segment->magic = RADAR_METRICS_MAGIC;
+    atomic_store_explicit(&segment->sequence, 2, memory_order_release);
+    return metrics;
+#else
+    (void) name;
+    fprintf(stderr, "Metrics segment not available on this platform\n");
+    return NULL;
+#endif
+}
+
+void radar_metrics_close(RadarMetrics *metrics) {
+    if (metrics == NULL) return;
+#ifdef RADAR_METRICS_SHM
+    if (metrics->owner) {
+        metrics->segment->magic = 0;
+        shm_unlink(metrics->name);
+    }
+    munmap(metrics->segment, sizeof(RadarMetricsSegment));
+#endif
+    free(metrics);
+}
+
+/**
+ * Start an update: the returned data can be written field by field until radar_metrics_end()
+ */
+RadarMetricsData* radar_metrics_begin(RadarMetrics *metrics) {
+    RadarMetricsSegment *segment = metrics->segment;
+    const Uint32 sequence = atomic_load_explicit(&segment->sequence, memory_order_relaxed);
+    atomic_store_explicit(&segment->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return &segment->data;
+}
+
+void radar_metrics_end(RadarMetrics *metrics) {
+    RadarMetricsSegment *segment = metrics->segment;
+    const Uint32 sequence = atomic_load_explicit(&segment->sequence, memory_order_relaxed);
+    atomic_store_explicit(&segment->sequence, sequence + 1, memory_order_release);
+}
+
+/**
+ * Reader side: map the segment of a running program read only.
+ * Returns NULL when it does not exist or was written by another version.
+ */
+RadarMetrics* radar_metrics_open(const char *name) {
+#ifdef RADAR_METRICS_SHM
+    if (name == NULL) name = RADAR_METRICS_DEFAULT_NAME;
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open metrics segment %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < (off_t) sizeof(RadarMetricsSegment)) {
+        fprintf(stderr, "Metrics segment %s is too small\n", name);
+        close(fd);
+        return NULL;
+    }
+    RadarMetricsSegment *segment = mmap(NULL, sizeof(RadarMetricsSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        fprintf(stderr, "Could not map metrics segment %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    if (segment->magic != RADAR_METRICS_MAGIC || segment->version != RADAR_METRICS_VERSION || segment->size != sizeof(RadarMetricsSegment)) {
+        fprintf(stderr, "Metrics segment %s has version %u, this reader expects %u\n", name, segment->version, RADAR_METRICS_VERSION);
+        munmap(segment, sizeof(RadarMetricsSegment));
+        return NULL;
+    }
+
+    RadarMetrics *metrics = calloc(1, sizeof(RadarMetrics));
+    if (metrics == NULL) {
+        munmap(segment, sizeof(RadarMetricsSegment));
+        return NULL;
+    }
+    snprintf(metrics->name, sizeof(metrics->name), "%s", name);
+    metrics->segment = segment;
+    return metrics;
+#else
+    (void) name;
+    fprintf(stderr, "Metrics segment not available on this platform\n");
+    return NULL;
+#endif
+}
+
+/**
+ * Consistent copy of the data, false when the writer is gone or kept it busy for every retry
+ */
+bool radar_metrics_read(const RadarMetrics *metrics, RadarMetricsData *data) {
+    RadarMetricsSegment *segment = metrics->segment;
+    for (int retry = 0; retry < RADAR_METRICS_READ_RETRIES; ++retry) {
+        if (segment->magic != RADAR_METRICS_MAGIC) return false;
+        const Uint32 before = atomic_load_explicit(&segment->sequence, memory_order_acquire);
+        if (before & 1) continue;
+        memcpy(data, &segment->data, sizeof(*data));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&segment->sequence, memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
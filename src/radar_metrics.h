@@ -0,0 +1,59 @@
+#ifndef RADAR_METRICS_H
+#define RADAR_METRICS_H
+#include <SDL2/SDL_stdinc.h>
+#include <stdbool.h>
+
+#define RADAR_METRICS_DEFAULT_NAME "/sdlradar-metrics"
+#define RADAR_METRICS_MAGIC 0x52444d53u // "RDMS"
+#define RADAR_METRICS_VERSION 1         // Bumped on any change of RadarMetricsData
+#define RADAR_METRICS_READ_RETRIES 1000 // Torn reads tried again before radar_metrics_read() gives up
+
+/**
+ * Live values of the program, rewritten once per drawn frame. Durations are those of the last frame,
+ * taken from the profiler stages.
+ */
+typedef struct {
+    Uint64 frame;          // Frames drawn since the start
+    Uint64 timeMs;         // SDL_GetTicks64() of the last publication
+    Uint32 frameUs;        // Whole frame, from the end of the event wait to the present
+    Uint32 trailUs;        // Trail of all the scopes
+    Uint32 sphereUs;       // Display remap (sphere, B-scope, sector) of all the scopes, 0 in PPI
+    Uint32 contacts;       // Live contacts over all the scopes
+    Uint32 scopes;
+    Uint32 audioUnderruns; // Audio callbacks that came too late to keep the device fed, since the start
+    Uint32 ingestDepth;    // Contacts waiting to be added to a scope, 0 while contacts are only added from the main loop
+    Uint32 idle;           // 1 when the loop went to sleep before this frame
+} RadarMetricsData;
+
+/**
+ * Layout of the shared memory segment. The writer makes the sequence odd before touching data and
+ * even again after (seqlock): readers copy data and retry when the sequence was odd or moved.
+ */
+typedef struct {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 size;              // sizeof(RadarMetricsSegment) of the writer
+    Uint32 pid;               // Writer process
+    _Atomic(Uint32) sequence;
+    Uint32 reserved;
+    RadarMetricsData data;
+} RadarMetricsSegment;
+
+/**
+ * Writer side: a POSIX shared memory object created by the program, unlinked by radar_metrics_close()
+ */
+typedef struct {
+    char name[64];
+    RadarMetricsSegment *segment;
+    bool owner; // Created by this process and unlinked on close
+} RadarMetrics;
+
+RadarMetrics* radar_metrics_create(const char *name);
+void radar_metrics_close(RadarMetrics *metrics);
+RadarMetricsData* radar_metrics_begin(RadarMetrics *metrics);
+void radar_metrics_end(RadarMetrics *metrics);
+
+RadarMetrics* radar_metrics_open(const char *name);
+bool radar_metrics_read(const RadarMetrics *metrics, RadarMetricsData *data);
+
+#endif
@@ -0,0 +1,83 @@
+#include "radar_metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Print the live metrics of a running radar program, from its shared memory segment.
+ *
+ * Usage: radar_metrics_reader [--name=/sdlradar-metrics] [--watch[=ms]] [--format=text|json]
+ * Without --watch one line is printed; with it a line is printed every interval (1000 ms by default)
+ * until the program exits.
+ */
+
+typedef struct {
+    const char *name;
+    int watchMs; // 0 for a single line
+    int json;
+} ReaderOptions;
+
+static int parse_options(int argc, char **argv, ReaderOptions *options) {
+    *options = (ReaderOptions){.name = RADAR_METRICS_DEFAULT_NAME};
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--name=", 7) == 0) options->name = arg + 7;
+        else if (strcmp(arg, "--watch") == 0) options->watchMs = 1000;
+        else if (strncmp(arg, "--watch=", 8) == 0) options->watchMs = atoi(arg + 8);
+        else if (strcmp(arg, "--format=json") == 0) options->json = 1;
+        else if (strcmp(arg, "--format=text") == 0) options->json = 0;
+        else {
+            fprintf(stderr, "Usage: %s [--name=%s] [--watch[=ms]] [--format=text|json]\n", argv[0], RADAR_METRICS_DEFAULT_NAME);
+            return -1;
+        }
+    }
+    if (options->watchMs < 0) options->watchMs = 0;
+    return 0;
+}
+
+static void print_metrics(const ReaderOptions *options, const RadarMetricsData *data) {
+    if (options->json) {
+        printf("{\"frame\": %llu, \"time_ms\": %llu, \"frame_us\": %u, \"trail_us\": %u, \"sphere_us\": %u, "
+               "\"contacts\": %u, \"scopes\": %u, \"audio_underruns\": %u, \"ingest_depth\": %u, \"idle\": %u}\n",
+            (unsigned long long) data->frame, (unsigned long long) data->timeMs, data->frameUs, data->trailUs, data->sphereUs,
+            data->contacts, data->scopes, data->audioUnderruns, data->ingestDepth, data->idle);
+    } else {
+        printf("frame %llu at %llu ms: frame %.3f ms, trail %.3f ms, sphere %.3f ms, %u contacts on %u scopes, "
+               "%u audio underruns, ingest depth %u%s\n",
+            (unsigned long long) data->frame, (unsigned long long) data->timeMs,
+            data->frameUs / 1000.0, data->trailUs / 1000.0, data->sphereUs / 1000.0,
+            data->contacts, data->scopes, data->audioUnderruns, data->ingestDepth, data->idle ? ", idle" : "");
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    ReaderOptions options;
+    if (parse_options(argc, argv, &options) != 0) {
+        return 1;
+    }
+
+    RadarMetrics *metrics = radar_metrics_open(options.name);
+    if (metrics == NULL) {
+        return 1;
+    }
+
+    int status = 0;
+    do {
+        RadarMetricsData data;
+        if (!radar_metrics_read(metrics, &data)) {
+            fprintf(stderr, "Metrics segment %s is gone or not readable\n", options.name);
+            status = 1;
+            break;
+        }
+        print_metrics(&options, &data);
+        if (options.watchMs > 0) {
+            const struct timespec interval = {options.watchMs / 1000, (long) (options.watchMs % 1000) * 1000000L};
+            nanosleep(&interval, NULL);
+        }
+    } while (options.watchMs > 0);
+
+    radar_metrics_close(metrics);
+    return status;
+}
@@ -1,25 +1,78 @@
 #include "radar_object.h"
-#include <SDL2_gfxPrimitives.h>
+#include "radar_primitive.h"
+#include "radar_terrain.h"
+#include "radar_track.h"
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
-void radar_object_list_add(RadarObjectLinkedList *objectLst, RadarObject radarObject) {
-    while (objectLst->next != NULL) {
-        objectLst = objectLst->next;
+/**
+ * Chain the capacity nodes of the block in the free list (block may be NULL, the pool is then empty)
+ */
+void radar_object_pool_init(RadarObjectPool *pool, RadarObjectLinkedList *nodes, int capacity) {
+    *pool = (RadarObjectPool){.nodes = nodes, .capacity = nodes != NULL ? capacity : 0};
+    for (int i = pool->capacity - 1; i >= 0; --i) {
+        nodes[i].next = pool->freeList;
+        pool->freeList = &nodes[i];
     }
-    objectLst->next = malloc(sizeof(RadarObjectLinkedList));
-    objectLst->next->object = radarObject;
-    objectLst->next->next = NULL;
 }
 
-void radar_object_list_clear(RadarObjectLinkedList *objectLst) {
-    RadarObjectLinkedList *tmp = objectLst;
-    while (objectLst->next != NULL) {
-        while (tmp->next != NULL) {
-            tmp = tmp->next;
-        }
-        free(tmp->next);
+static RadarObjectLinkedList* radar_object_node_acquire(Radar *radar) {
+    RadarObjectPool *pool = &radar->contactPool;
+    RadarObjectLinkedList *node = pool->freeList;
+    if (node == NULL) return NULL;
+    pool->freeList = node->next;
+    pool->used++;
+    node->next = NULL;
+    node->id = ++pool->lastId;
+    return node;
+}
+
+static void radar_object_node_release(Radar *radar, RadarObjectLinkedList *node) {
+    RadarObjectPool *pool = &radar->contactPool;
+    node->next = pool->freeList;
+    pool->freeList = node;
+    pool->used--;
+}
+
+/**
+ * Append a contact, returns false when the pool (radar->max_contacts) is full
+ */
+bool radar_object_list_add(Radar *radar, RadarObject radarObject) {
+    RadarObjectLinkedList *node = radar_object_node_acquire(radar);
+    if (node == NULL) return false;
+    node->object = radarObject;
+
+    RadarObjectLinkedList **link = &radar->radar_objects;
+    while (*link != NULL) {
+        link = &(*link)->next;
+    }
+    *link = node;
+    radar->needsRedraw = true;
+    return true;
+}
+
+void radar_object_list_clear(Radar *radar) {
+    RadarObjectLinkedList *objectLst = radar->radar_objects;
+    while (objectLst != NULL) {
+        RadarObjectLinkedList *next = objectLst->next;
+        radar_object_node_release(radar, objectLst);
+        objectLst = next;
+    }
+    radar->radar_objects = NULL;
+    radar->needsRedraw = true;
+}
+
+/**
+ * Whether radar_object_list_anim_update() would change anything: a contact moves, fades out or waits for removal
+ */
+bool radar_object_list_is_animating(const Radar *radar) {
+    for (const RadarObjectLinkedList *objectLst = radar->radar_objects; objectLst != NULL; objectLst = objectLst->next) {
+        const RadarObject *object = &objectLst->object;
+        if (object->status != RADAR_OBJECT_STATUS_ALIVE || object->speed != 0.0) return true;
     }
+    return false;
 }
 
 void radar_object_list_anim_update(Radar *radar) {
@@ -36,11 +89,11 @@ void radar_object_list_anim_update(Radar *radar) {
                     } else {
                         radar->radar_objects = objectLst->next;
                     }
-                    free(objectLst);
+                    radar_object_node_release(radar, objectLst);
                     objectLst = radar->radar_objects;
                 } else {
                     prevObj->next = objectLst->next;
-                    free(objectLst);
+                    radar_object_node_release(radar, objectLst);
                     objectLst = prevObj;
                 }
                 break;
@@ -53,21 +106,23 @@ void radar_object_list_anim_update(Radar *radar) {
         }
         prevObj = objectLst;
     } while(objectLst != NULL && (objectLst = objectLst->next) != NULL);
+    radar_tracks_record(radar);
 }
 
 void radar_object_anim_update(const Radar *radar, RadarObject *radarObject) {
-    double offsetX = radarObject->speed * cos(radarObject->directionAngle);
-    double offsetY = radarObject->speed * sin(radarObject->directionAngle);
-    radarObject->x += offsetX>-1 && offsetX<0 ? -1 : offsetX>0 && offsetX<-1 ? 1 : offsetX;
-    radarObject->y += offsetY>-1 && offsetY<0 ? -1 : offsetY>0 && offsetY<-1 ? 1 : offsetY;
+    radarObject->x += radarObject->speed * cos(radarObject->directionAngle);
+    radarObject->y += radarObject->speed * sin(radarObject->directionAngle);
 
     if (!radar_object_isIn(radar, radarObject)) {
         radarObject->status = RADAR_OBJECT_STATUS_DEAD;
     }
 }
 
-bool radar_object_isIn(Radar *radar, RadarObject *object) {
-    return sqrt(pow(object->x,2) + pow(object->y,2)) < radar->radius;
+/**
+ * Whether the contact is still in the theater; contacts out of the view but in the theater stay alive
+ */
+bool radar_object_isIn(const Radar *radar, const RadarObject *object) {
+    return object->x * object->x + object->y * object->y < radar->theater_range * radar->theater_range;
 }
 
 void radar_object_anim_destroy(RadarObject *radarObject) {
@@ -85,23 +140,21 @@ void radar_object_anim_destroy(RadarObject *radarObject) {
 
 void radar_object_list_anim_render(const Radar *radar) {
     if (radar->radar_objects==NULL) return;
+    radar_tracks_draw(radar);
 
     RadarObjectLinkedList *objectLst = radar->radar_objects;
-    SDL_SetRenderTarget(radar->renderer, radar->workingTexture);
     do{
         radar_object_anim_render(radar, &objectLst->object);
     }while((objectLst = objectLst->next) != NULL);
 }
 
-void radar_object_anim_render(const Radar *radar, RadarObject *radarObject) {
-    if (radarObject == NULL || radarObject->status != RADAR_OBJECT_STATUS_ALIVE)
-        return;
-
-    SDL_Renderer* renderer = radar->renderer;
-    // Determine color based on an object type
+/**
+ * Display color of a contact from its type, half transparent
+ */
+SDL_Color radar_object_color(const RadarObject *object) {
     SDL_Color color;
-    if (radarObject->type < 0) { // Negative types are enemies
-        switch (radarObject->type) {
+    if (object->type < 0) { // Negative types are enemies
+        switch (object->type) {
             case ENEMY_DRONE: color = (SDL_Color){255, 0, 0, 128}; break; // red with transparency
             case ENEMY_TANK: color = (SDL_Color){255, 100, 0, 128}; break; // orange
             case ENEMY_BOMBER: color = (SDL_Color){255, 50, 50, 128}; break; // pink
@@ -111,8 +164,8 @@ void radar_object_anim_render(const Radar *radar, RadarObject *radarObject) {
             case ENEMY_BOSSES: color = (SDL_Color){255, 0, 0, 128}; break; // red
             default: color = (SDL_Color){255,255,255,128}; break;
         }
-    } else if (radarObject->type > 0) { // positive types are allies
-        switch (radarObject->type) {
+    } else if (object->type > 0) { // positive types are allies
+        switch (object->type) {
             case ALLY_SCOUT: color = (SDL_Color){0, 255, 0, 128}; break; // green
             case ALLY_MEDIC: color = (SDL_Color){0, 0, 255, 128}; break; // blue
             case ALLY_TANKER: color = (SDL_Color){0, 128, 255, 128}; break; // light-blue
@@ -125,37 +178,63 @@ void radar_object_anim_render(const Radar *radar, RadarObject *radarObject) {
     } else {
         color = (SDL_Color){0, 128, 0, 128};
     }
+    return color;
+}
+
+void radar_object_anim_render(const Radar *radar, RadarObject *radarObject) {
+    if (radarObject == NULL || radarObject->status != RADAR_OBJECT_STATUS_ALIVE)
+        return;
+    if (!radar_terrain_visible(radar->terrain, radarObject->x, radarObject->y))
+        return;
+    int scopeX, scopeY;
+    if (!radar_object_project(radar, radarObject, &scopeX, &scopeY))
+        return;
+    const int centerX = scopeX + RADAR_CENTER_X(radar);
+    const int centerY = scopeY + RADAR_CENTER_Y(radar);
+
+    SDL_Renderer* renderer = radar->renderer;
+    const SDL_Color color = radar_object_color(radarObject);
 
-    // Draw a blur effect: multiple circles with decreasing alpha
     int layers_r = radarObject->radius/3;
-    for (int i = 0; i <= radarObject->radius; i+=layers_r) {
-        if (radarObject->radius-i >= radarObject->radius-layers_r) {
-            filledCircleRGBA(renderer,  radarObject->x + radar->radius+radar->padding, radarObject->y + radar->radius+radar->padding, i, color.r, color.g, color.b, 255);
+    if (radar->bloom != NULL) {
+        // The bloom pass makes the glow over the whole scope, only the core is drawn
+        radar_primitive_filled_circle(radar, centerX, centerY, layers_r, (SDL_Color){color.r, color.g, color.b, 255});
+    } else {
+        // Draw a blur effect: multiple circles with decreasing alpha
+        for (int i = 0; i <= radarObject->radius; i+=layers_r) {
+            if (radarObject->radius-i >= radarObject->radius-layers_r) {
+                radar_primitive_filled_circle(radar, centerX, centerY, i, (SDL_Color){color.r, color.g, color.b, 255});
+            }
+            radar_primitive_filled_circle(radar, centerX, centerY, i, (SDL_Color){color.r, color.g, color.b, color.a/3});
         }
-        filledCircleRGBA(renderer,  radarObject->x + radar->radius+radar->padding, radarObject->y + radar->radius+radar->padding, i, color.r, color.g, color.b, color.a/3);
     }
 
     SDL_Color clearColor = {0, 0, 0, 0};
     SDL_SetRenderDrawColor(renderer, clearColor.r, clearColor.g, clearColor.b, clearColor.a);
 }
 
-RadarObjectLinkedList* radar_object_generate_random_list(Radar *radar) {
-    const int NUM_OBJECTS = 10; // Adjust as needed
-    RadarObjectLinkedList *head = malloc(sizeof(RadarObjectLinkedList));
-    head->next = NULL;
+/**
+ * Build a list of count random contacts from the radar pool, shorter if the pool runs out
+ */
+RadarObjectLinkedList* radar_object_generate_random_list(Radar *radar, int count) {
+    RadarObjectLinkedList *head = NULL;
+    RadarObjectLinkedList *current = NULL;
 
-    RadarObjectLinkedList *current = head;
-    RadarObjectLinkedList *new_node = head;
+    for (int i = 0; i < count; ++i) {
+        RadarObjectLinkedList *new_node = radar_object_node_acquire(radar);
+        if (new_node == NULL) {
+            fprintf(stderr, "Contact pool full: %d of %d contacts generated\n", i, count);
+            break;
+        }
 
-    for (int i = 0; i < NUM_OBJECTS; ++i) {
         // Allocate a new RadarObject
         new_node->object = (RadarObject) {
-            .x = rand() % radar->radius/2,
-            .y = rand() % radar->radius/2,
+            .x = (rand() % (radar->radius/2)) * radar->range_scale,
+            .y = (rand() % (radar->radius/2)) * radar->range_scale,
             .radius = 16 + rand() % 8, // radius between 2 and 10
             .radius_memory = 0,
             .directionAngle = ((double)rand() / RAND_MAX) * 2 * M_PI,
-            .speed = ((double) (rand()%(radar->radius/100))) * ((rand() % 2) * 2 - 1),
+            .speed = ((double) (rand()%(radar->radius/100))) * ((rand() % 2) * 2 - 1) * radar->range_scale,
             .status = (rand() % 3) - 1, // -1, 0, or 1
             .type = -1
         };
@@ -168,16 +247,13 @@ RadarObjectLinkedList* radar_object_generate_random_list(Radar *radar) {
             new_node->object.type = (rand() % 8);
         }
 
-        if (new_node != current) {
+        if (current == NULL) {
+            head = new_node;
+        } else {
             current->next = new_node;
         }
         current = new_node;
-
-        // Allocate a new node
-        new_node = malloc(sizeof(RadarObjectLinkedList));
-        new_node->next = NULL;
     }
 
-    free(new_node);
     return head;
 }
\ No newline at end of file
@@ -1,17 +1,44 @@
 #ifndef RADAR_OBJECT_H
 #define RADAR_OBJECT_H
 #include "radar.h"
+#include <math.h>
 
-void radar_object_list_add(RadarObjectLinkedList *objectLst, RadarObject radarObject);
-void radar_object_list_clear(RadarObjectLinkedList *objectLst);
+void radar_object_pool_init(RadarObjectPool *pool, RadarObjectLinkedList *nodes, int capacity);
+bool radar_object_list_add(Radar *radar, RadarObject radarObject);
+void radar_object_list_clear(Radar *radar);
+bool radar_object_list_is_animating(const Radar *radar);
 
 void radar_object_list_anim_update(Radar *radar);
 void radar_object_anim_update(const Radar *radar, RadarObject *radarObject);
-bool radar_object_isIn(Radar *radar, RadarObject *object);
+bool radar_object_isIn(const Radar *radar, const RadarObject *object);
 void radar_object_anim_destroy(RadarObject *radarObject);
+SDL_Color radar_object_color(const RadarObject *object);
 void radar_object_list_anim_render(const Radar *radar);
 void radar_object_anim_render(const Radar *radar, RadarObject *radarObject);
 
-RadarObjectLinkedList* radar_object_generate_random_list(Radar *radar);
+RadarObjectLinkedList* radar_object_generate_random_list(Radar *radar, int count);
+
+/**
+ * Scope pixels from the scope center of a world position, through the current view
+ */
+static inline void radar_view_to_scope(const Radar *radar, double x, double y, int *scopeX, int *scopeY) {
+    *scopeX = (int) lround((x - radar->view.centerX) * radar->view.scale);
+    *scopeY = (int) lround((y - radar->view.centerY) * radar->view.scale);
+}
+
+/**
+ * Scope position of a contact, false when no part of it falls in the scope.
+ * A bounding box test first, so the contacts far out of a zoomed in view are rejected without a multiply.
+ */
+static inline bool radar_object_project(const Radar *radar, const RadarObject *object, int *scopeX, int *scopeY) {
+    const double dx = object->x - radar->view.centerX;
+    const double dy = object->y - radar->view.centerY;
+    const double reach = radar->view.range + object->radius / radar->view.scale;
+    if (dx > reach || dx < -reach || dy > reach || dy < -reach) return false;
+    if (dx * dx + dy * dy > reach * reach) return false;
+    *scopeX = (int) lround(dx * radar->view.scale);
+    *scopeY = (int) lround(dy * radar->view.scale);
+    return true;
+}
 
 #endif
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "radar_primitive.h"
+#include "radar_raster.h"
+#include "radar_batch.h"
+#include <SDL2_gfxPrimitives.h>
+#include <SDL2/SDL.h>
+
+// SDL2_gfx integer coordinates address pixels, the batch works on their centers
+#define RADAR_PIXEL_CENTER(v) ((float) (v) + 0.5f)
+
+void radar_primitive_hairline(const Radar *radar, int x1, int y1, int x2, int y2, SDL_Color color) {
+    switch (radar->backend) {
+        case RADAR_BACKEND_CPU:
+            radar_raster_hairline(radar->raster, x1, y1, x2, y2, RADAR_RASTER_RGBA(color));
+            break;
+        case RADAR_BACKEND_GEOMETRY:
+            radar_batch_line(radar->batch, RADAR_PIXEL_CENTER(x1), RADAR_PIXEL_CENTER(y1),
+                RADAR_PIXEL_CENTER(x2), RADAR_PIXEL_CENTER(y2), 1.0f, color);
+            break;
+        default:
+            SDL_SetRenderDrawColor(radar->renderer, color.r, color.g, color.b, color.a);
+            SDL_RenderDrawLine(radar->renderer, x1, y1, x2, y2);
+            break;
+    }
+}
+
+void radar_primitive_line(const Radar *radar, int x1, int y1, int x2, int y2, int width, SDL_Color color) {
+    switch (radar->backend) {
+        case RADAR_BACKEND_CPU:
+            radar_raster_line(radar->raster, x1, y1, x2, y2, width, RADAR_RASTER_RGBA(color));
+            break;
+        case RADAR_BACKEND_GEOMETRY:
+            radar_batch_line(radar->batch, RADAR_PIXEL_CENTER(x1), RADAR_PIXEL_CENTER(y1),
+                RADAR_PIXEL_CENTER(x2), RADAR_PIXEL_CENTER(y2), width, color);
+            break;
+        default:
+            thickLineRGBA(radar->renderer, x1, y1, x2, y2, width, color.r, color.g, color.b, color.a);
+            break;
+    }
+}
+
+void radar_primitive_ring(const Radar *radar, int x, int y, int radius, SDL_Color color) {
+    switch (radar->backend) {
+        case RADAR_BACKEND_CPU:
+            radar_raster_ring(radar->raster, x, y, radius, RADAR_RASTER_RGBA(color));
+            break;
+        case RADAR_BACKEND_GEOMETRY:
+            radar_batch_ring(radar->batch, RADAR_PIXEL_CENTER(x), RADAR_PIXEL_CENTER(y), radius, color);
+            break;
+        default:
+            aacircleRGBA(radar->renderer, x, y, radius, color.r, color.g, color.b, color.a);
+            break;
+    }
+}
+
+void radar_primitive_filled_circle(const Radar *radar, int x, int y, int radius, SDL_Color color) {
+    switch (radar->backend) {
+        case RADAR_BACKEND_CPU:
+            radar_raster_filled_circle(radar->raster, x, y, radius, RADAR_RASTER_RGBA(color));
+            break;
+        case RADAR_BACKEND_GEOMETRY:
+            radar_batch_filled_circle(radar->batch, RADAR_PIXEL_CENTER(x), RADAR_PIXEL_CENTER(y), radius, color);
+            break;
+        default:
+            filledCircleRGBA(radar->renderer, x, y, radius, color.r, color.g, color.b, color.a);
+            break;
+    }
+}
+
+void radar_primitive_rounded_box(const Radar *radar, int x1, int y1, int x2, int y2, int corner, SDL_Color color) {
+    switch (radar->backend) {
+        case RADAR_BACKEND_CPU:
+            radar_raster_rounded_box(radar->raster, x1, y1, x2, y2, corner, RADAR_RASTER_RGBA(color));
+            break;
+        case RADAR_BACKEND_GEOMETRY:
+            // Inclusive pixel bounds to edges
+            radar_batch_rounded_box(radar->batch, SDL_min(x1, x2), SDL_min(y1, y2),
+                SDL_max(x1, x2) + 1, SDL_max(y1, y2) + 1, corner, color);
+            break;
+        default:
+            roundedBoxRGBA(radar->renderer, x1, y1, x2, y2, corner, color.r, color.g, color.b, color.a);
+            break;
+    }
+}
+
+/**
+ * Draw what the backend kept pending: the CPU raster commands into its buffer, the geometry batch
+ * into the current render target. SDL2_gfx draws immediately, nothing to do.
+ */
+void radar_primitive_flush(const Radar *radar) {
+    switch (radar->backend) {
+        case RADAR_BACKEND_CPU:
+            radar_raster_flush(radar->raster);
+            break;
+        case RADAR_BACKEND_GEOMETRY:
+            radar_batch_flush(radar->batch, radar->renderer);
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef RADAR_PRIMITIVE_H
+#define RADAR_PRIMITIVE_H
+#include "radar.h"
+
+/**
+ * Scope primitives, drawn with SDL2_gfx, batched as geometry or recorded in the CPU raster depending
+ * on radar->backend. Coordinates are in the current target (see RADAR_CENTER_X/Y).
+ * Batched and recorded primitives only reach the target on radar_primitive_flush().
+ */
+void radar_primitive_hairline(const Radar *radar, int x1, int y1, int x2, int y2, SDL_Color color);
+void radar_primitive_line(const Radar *radar, int x1, int y1, int x2, int y2, int width, SDL_Color color);
+void radar_primitive_ring(const Radar *radar, int x, int y, int radius, SDL_Color color);
+void radar_primitive_filled_circle(const Radar *radar, int x, int y, int radius, SDL_Color color);
+void radar_primitive_rounded_box(const Radar *radar, int x1, int y1, int x2, int y2, int corner, SDL_Color color);
+void radar_primitive_flush(const Radar *radar);
+
+#endif
@@ -0,0 +1,181 @@
+#include "radar.h"
+#include "radar_profiler.h"
+#include <SDL2_gfxPrimitives.h>
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* STAGE_NAMES[RADAR_STAGE_COUNT] = {
+    "static_layer",
+    "grid",
+    "circles",
+    "echo",
+    "sweep_line",
+    "trail",
+    "bloom",
+    "contact_update",
+    "proximity",
+    "contact_render",
+    "remap",
+    "radar_render",
+    "labels",
+    "present",
+    "frame"
+};
+
+RadarProfiler* radar_profiler_create(void) {
+    RadarProfiler *profiler = calloc(1, sizeof(RadarProfiler));
+    if (profiler == NULL) return NULL;
+    profiler->frequency = SDL_GetPerformanceFrequency();
+    for (int s = 0; s < RADAR_STAGE_COUNT; ++s) {
+        profiler->timers[s].min_ticks = UINT64_MAX;
+    }
+    return profiler;
+}
+
+void radar_profiler_destroy(RadarProfiler *profiler) {
+    free(profiler);
+}
+
+void radar_profiler_toggle_hud(RadarProfiler *profiler) {
+    if (profiler == NULL) return;
+    profiler->hud_visible = !profiler->hud_visible;
+    // Showing the HUD starts the collection, hiding it goes back to whatever was asked at startup
+    profiler->enabled = profiler->hud_visible || profiler->always_enabled;
+}
+
+const char* radar_profiler_stage_name(RadarProfilerStage stage) {
+    if (stage < 0 || stage >= RADAR_STAGE_COUNT) return "unknown";
+    return STAGE_NAMES[stage];
+}
+
+void radar_profiler_record(RadarProfiler *profiler, RadarProfilerStage stage, Uint64 ticks) {
+    RadarProfilerTimer *timer = &profiler->timers[stage];
+    timer->samples[timer->sample_index] = ticks;
+    timer->sample_index = (timer->sample_index + 1) % RADAR_PROFILER_SAMPLES;
+    if (timer->sample_count < RADAR_PROFILER_SAMPLES) {
+        timer->sample_count++;
+    }
+    timer->calls++;
+    timer->total_ticks += ticks;
+    if (ticks < timer->min_ticks) timer->min_ticks = ticks;
+    if (ticks > timer->max_ticks) timer->max_ticks = ticks;
+
+    // The frame stage ends last: it closes the totals of the frame
+    profiler->frame_ticks[stage] += ticks;
+    if (stage == RADAR_STAGE_FRAME) {
+        memcpy(profiler->last_frame_ticks, profiler->frame_ticks, sizeof(profiler->frame_ticks));
+        memset(profiler->frame_ticks, 0, sizeof(profiler->frame_ticks));
+    }
+}
+
+static int compare_ticks(const void *a, const void *b) {
+    Uint64 ta = *(const Uint64*) a;
+    Uint64 tb = *(const Uint64*) b;
+    return (ta > tb) - (ta < tb);
+}
+
+static double ticks_to_ms(const RadarProfiler *profiler, Uint64 ticks) {
+    return (double) ticks * 1000.0 / (double) profiler->frequency;
+}
+
+/**
+ * Time spent in a stage during the last complete frame, summed over the scopes; 0 while the profiler is off
+ */
+double radar_profiler_last_frame_ms(const RadarProfiler *profiler, RadarProfilerStage stage) {
+    if (profiler == NULL || stage < 0 || stage >= RADAR_STAGE_COUNT) return 0.0;
+    return ticks_to_ms(profiler, profiler->last_frame_ticks[stage]);
+}
+
+void radar_profiler_window_stats(const RadarProfiler *profiler, RadarProfilerStage stage, RadarProfilerStats *stats) {
+    const RadarProfilerTimer *timer = &profiler->timers[stage];
+    *stats = (RadarProfilerStats){0};
+    if (timer->sample_count == 0) return;
+
+    Uint64 sorted[RADAR_PROFILER_SAMPLES];
+    Uint64 sum = 0;
+    memcpy(sorted, timer->samples, sizeof(Uint64) * timer->sample_count);
+    for (int i = 0; i < timer->sample_count; ++i) {
+        sum += sorted[i];
+    }
+    qsort(sorted, timer->sample_count, sizeof(Uint64), compare_ticks);
+
+    int p99 = (timer->sample_count * 99) / 100;
+    if (p99 >= timer->sample_count) p99 = timer->sample_count - 1;
+
+    stats->min_ms = ticks_to_ms(profiler, sorted[0]);
+    stats->avg_ms = ticks_to_ms(profiler, sum) / timer->sample_count;
+    stats->p99_ms = ticks_to_ms(profiler, sorted[p99]);
+    stats->max_ms = ticks_to_ms(profiler, sorted[timer->sample_count - 1]);
+}
+
+void radar_profiler_render_hud(const RadarProfiler *profiler, SDL_Renderer *renderer, int x, int y) {
+    if (profiler == NULL || !profiler->hud_visible) return;
+
+    const int LINE_HEIGHT = 10;
+    char line[96];
+
+    boxRGBA(renderer, x-4, y-4, x+8*44+4, y+LINE_HEIGHT*(RADAR_STAGE_COUNT+1)+2, 0, 0, 0, 180);
+    snprintf(line, sizeof(line), "%-15s %8s %8s %8s", "stage (ms)", "min", "avg", "p99");
+    stringRGBA(renderer, x, y, line, 255, 255, 255, 255);
+
+    for (int s = 0; s < RADAR_STAGE_COUNT; ++s) {
+        RadarProfilerStats stats;
+        radar_profiler_window_stats(profiler, s, &stats);
+        snprintf(line, sizeof(line), "%-15s %8.3f %8.3f %8.3f",
+            radar_profiler_stage_name(s), stats.min_ms, stats.avg_ms, stats.p99_ms);
+        stringRGBA(renderer, x, y + LINE_HEIGHT*(s+1), line, 100, 255, 100, 255);
+    }
+}
+
+/**
+ * Write the collected timings, as JSON when the path ends with ".json" and as CSV otherwise.
+ * Lifetime min/avg/max are over every recorded call, p99 is over the rolling window.
+ * @return 0 on success, -1 when the file could not be written
+ */
+int radar_profiler_dump(const RadarProfiler *profiler, const char *path) {
+    if (profiler == NULL || path == NULL) return -1;
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not write profile to %s\n", path);
+        return -1;
+    }
+
+    size_t pathLength = strlen(path);
+    bool json = pathLength > 5 && strcmp(path + pathLength - 5, ".json") == 0;
+
+    if (json) {
+        fprintf(file, "{\n  \"stages\": [\n");
+    } else {
+        fprintf(file, "stage,calls,min_ms,avg_ms,p99_ms,max_ms\n");
+    }
+
+    for (int s = 0; s < RADAR_STAGE_COUNT; ++s) {
+        const RadarProfilerTimer *timer = &profiler->timers[s];
+        RadarProfilerStats window;
+        radar_profiler_window_stats(profiler, s, &window);
+
+        double min_ms = timer->calls ? ticks_to_ms(profiler, timer->min_ticks) : 0.0;
+        double avg_ms = timer->calls ? ticks_to_ms(profiler, timer->total_ticks) / timer->calls : 0.0;
+        double max_ms = ticks_to_ms(profiler, timer->max_ticks);
+
+        if (json) {
+            fprintf(file, "    {\"stage\": \"%s\", \"calls\": %llu, \"min_ms\": %.4f, \"avg_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f}%s\n",
+                radar_profiler_stage_name(s), (unsigned long long) timer->calls,
+                min_ms, avg_ms, window.p99_ms, max_ms, s+1 < RADAR_STAGE_COUNT ? "," : "");
+        } else {
+            fprintf(file, "%s,%llu,%.4f,%.4f,%.4f,%.4f\n",
+                radar_profiler_stage_name(s), (unsigned long long) timer->calls,
+                min_ms, avg_ms, window.p99_ms, max_ms);
+        }
+    }
+
+    if (json) {
+        fprintf(file, "  ]\n}\n");
+    }
+    fclose(file);
+    printf("Radar profile written to %s\n", path);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef RADAR_PROFILER_H
+#define RADAR_PROFILER_H
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#define RADAR_PROFILER_SAMPLES 240 // Rolling window, ~1s at the main loop rate
+
+typedef enum {
+    RADAR_STAGE_STATIC_LAYER,
+    RADAR_STAGE_GRID,
+    RADAR_STAGE_CIRCLES,
+    RADAR_STAGE_ECHO,
+    RADAR_STAGE_SWEEP_LINE,
+    RADAR_STAGE_TRAIL,
+    RADAR_STAGE_BLOOM,
+    RADAR_STAGE_CONTACT_UPDATE,
+    RADAR_STAGE_PROXIMITY,
+    RADAR_STAGE_CONTACT_RENDER,
+    RADAR_STAGE_REMAP,
+    RADAR_STAGE_RENDER,
+    RADAR_STAGE_LABELS,
+    RADAR_STAGE_PRESENT,
+    RADAR_STAGE_FRAME,
+    RADAR_STAGE_COUNT
+} RadarProfilerStage;
+
+typedef struct {
+    Uint64 start;
+    Uint64 samples[RADAR_PROFILER_SAMPLES];
+    int sample_count;
+    int sample_index;
+    Uint64 calls;
+    Uint64 total_ticks;
+    Uint64 min_ticks;
+    Uint64 max_ticks;
+} RadarProfilerTimer;
+
+typedef struct {
+    double min_ms;
+    double avg_ms;
+    double p99_ms;
+    double max_ms;
+} RadarProfilerStats;
+
+struct RadarProfiler {
+    bool enabled;
+    bool hud_visible;
+    bool always_enabled; // Collection asked at startup (dump, metrics), kept when the HUD is hidden
+    Uint64 frequency;
+    RadarProfilerTimer timers[RADAR_STAGE_COUNT];
+    Uint64 frame_ticks[RADAR_STAGE_COUNT];      // Stage totals of the frame in progress, over all the scopes
+    Uint64 last_frame_ticks[RADAR_STAGE_COUNT]; // Stage totals of the last complete frame
+};
+
+RadarProfiler* radar_profiler_create(void);
+void radar_profiler_destroy(RadarProfiler *profiler);
+void radar_profiler_toggle_hud(RadarProfiler *profiler);
+void radar_profiler_record(RadarProfiler *profiler, RadarProfilerStage stage, Uint64 ticks);
+void radar_profiler_window_stats(const RadarProfiler *profiler, RadarProfilerStage stage, RadarProfilerStats *stats);
+void radar_profiler_render_hud(const RadarProfiler *profiler, SDL_Renderer *renderer, int x, int y);
+int radar_profiler_dump(const RadarProfiler *profiler, const char *path);
+const char* radar_profiler_stage_name(RadarProfilerStage stage);
+double radar_profiler_last_frame_ms(const RadarProfiler *profiler, RadarProfilerStage stage);
+
+static inline void radar_profiler_begin(RadarProfiler *profiler, RadarProfilerStage stage) {
+    if (profiler != NULL && profiler->enabled) {
+        profiler->timers[stage].start = SDL_GetPerformanceCounter();
+    }
+}
+
+static inline void radar_profiler_end(RadarProfiler *profiler, RadarProfilerStage stage) {
+    if (profiler != NULL && profiler->enabled) {
+        radar_profiler_record(profiler, stage, SDL_GetPerformanceCounter() - profiler->timers[stage].start);
+    }
+}
+
+/**
+ * Scoped stage timers. Built with -DRADAR_PROFILER they cost one pointer test while the
+ * profiler is off; without it they compile to nothing.
+ */
+#ifdef RADAR_PROFILER
+#define RADAR_PROFILE_BEGIN(profiler, stage) radar_profiler_begin((profiler), (stage))
+#define RADAR_PROFILE_END(profiler, stage) radar_profiler_end((profiler), (stage))
+#else
+#define RADAR_PROFILE_BEGIN(profiler, stage) ((void)0)
+#define RADAR_PROFILE_END(profiler, stage) ((void)0)
+#endif
+
+#endif
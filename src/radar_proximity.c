@@ -0,0 +1,436 @@
+#include "radar_proximity.h"
+#include "radar_jobs.h"
+#include "radar_object.h"
+#include "radar_primitive.h"
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Default reach of each enemy type against any ally, in world units
+static const float RADAR_PROXIMITY_ENEMY_RANGES[RADAR_PROXIMITY_TYPES] = {
+    0.0f,   // unused
+    40.0f,  // ENEMY_DEFAULT
+    30.0f,  // ENEMY_DRONE
+    60.0f,  // ENEMY_TANK
+    50.0f,  // ENEMY_BOMBER
+    120.0f, // ENEMY_SNIPER
+    160.0f, // ENEMY_ARTILLERY
+    60.0f,  // ENEMY_ARMORED
+    100.0f  // ENEMY_BOSSES
+};
+
+RadarProximity* radar_proximity_create(void) {
+    RadarProximity *proximity = calloc(1, sizeof(RadarProximity));
+    if (proximity == NULL) {
+        fprintf(stderr, "Could not allocate the proximity detection\n");
+        return NULL;
+    }
+    for (int enemy = 1; enemy < RADAR_PROXIMITY_TYPES; ++enemy) {
+        for (int ally = 1; ally < RADAR_PROXIMITY_TYPES; ++ally) {
+            proximity->ranges[enemy][ally] = RADAR_PROXIMITY_ENEMY_RANGES[enemy];
+        }
+    }
+    return proximity;
+}
+
+static void radar_proximity_free_list(RadarProximityPairList *list) {
+    free(list->pairs);
+    *list = (RadarProximityPairList){0};
+}
+
+void radar_proximity_destroy(RadarProximity *proximity) {
+    if (proximity == NULL) return;
+    free(proximity->x);
+    free(proximity->y);
+    free(proximity->id);
+    free(proximity->type);
+    free(proximity->rawX);
+    free(proximity->rawY);
+    free(proximity->rawId);
+    free(proximity->rawType);
+    free(proximity->rawBucket);
+    free(proximity->bucketStart);
+    for (int i = 0; i < RADAR_PROXIMITY_MAX_JOBS; ++i) {
+        radar_proximity_free_list(&proximity->jobPairs[i]);
+    }
+    radar_proximity_free_list(&proximity->candidates);
+    radar_proximity_free_list(&proximity->sortBuffer);
+    radar_proximity_free_list(&proximity->pairs);
+    radar_proximity_free_list(&proximity->previous);
+    free(proximity->events);
+    free(proximity);
+}
+
+/**
+ * Range between an enemy type (negative) and an ally type (positive) in world units.
+ * A type of 0 sets the range against every type of the other side.
+ */
+void radar_proximity_set_range(RadarProximity *proximity, int enemyType, int allyType, float range) {
+    if (enemyType > 0 || -enemyType >= RADAR_PROXIMITY_TYPES || allyType < 0 || allyType >= RADAR_PROXIMITY_TYPES) {
+        fprintf(stderr, "Proximity: no range between types %d and %d\n", enemyType, allyType);
+        return;
+    }
+    for (int enemy = 1; enemy < RADAR_PROXIMITY_TYPES; ++enemy) {
+        if (enemyType != 0 && enemy != -enemyType) continue;
+        for (int ally = 1; ally < RADAR_PROXIMITY_TYPES; ++ally) {
+            if (allyType != 0 && ally != allyType) continue;
+            proximity->ranges[enemy][ally] = SDL_max(range, 0.0f);
+        }
+    }
+}
+
+// Grow an array to hold capacity elements, keeps it untouched and returns false when memory is exhausted
+static bool radar_proximity_grow(void **array, size_t elementSize, int capacity) {
+    void *grown = realloc(*array, elementSize * capacity);
+    if (grown == NULL) return false;
+    *array = grown;
+    return true;
+}
+
+static bool radar_proximity_reserve(RadarProximityPairList *list, int count) {
+    if (count <= list->capacity) return true;
+    int capacity = list->capacity > 0 ? list->capacity : 256;
+    while (capacity < count) capacity *= 2;
+    if (!radar_proximity_grow((void **) &list->pairs, sizeof(RadarProximityPair), capacity)) return false;
+    list->capacity = capacity;
+    return true;
+}
+
+static bool radar_proximity_reserve_contacts(RadarProximity *proximity, int count) {
+    if (count <= proximity->capacity) return true;
+    int capacity = proximity->capacity > 0 ? proximity->capacity : 256;
+    while (capacity < count) capacity *= 2;
+    if (!radar_proximity_grow((void **) &proximity->x, sizeof(float), capacity) ||
+        !radar_proximity_grow((void **) &proximity->y, sizeof(float), capacity) ||
+        !radar_proximity_grow((void **) &proximity->id, sizeof(Uint32), capacity) ||
+        !radar_proximity_grow((void **) &proximity->type, sizeof(Sint8), capacity) ||
+        !radar_proximity_grow((void **) &proximity->rawX, sizeof(float), capacity) ||
+        !radar_proximity_grow((void **) &proximity->rawY, sizeof(float), capacity) ||
+        !radar_proximity_grow((void **) &proximity->rawId, sizeof(Uint32), capacity) ||
+        !radar_proximity_grow((void **) &proximity->rawType, sizeof(Sint8), capacity) ||
+        !radar_proximity_grow((void **) &proximity->rawBucket, sizeof(int), capacity)) {
+        return false;
+    }
+    proximity->capacity = capacity;
+    return true;
+}
+
+/**
+ * Copy the live enemies and allies out of the contact list (neutral contacts have no engagement)
+ */
+static int radar_proximity_snapshot(RadarProximity *proximity, const Radar *radar) {
+    int count = 0;
+    for (const RadarObjectLinkedList *node = radar->radar_objects; node != NULL; node = node->next) {
+        if (node->object.status == RADAR_OBJECT_STATUS_ALIVE && node->object.type != 0) count++;
+    }
+    if (!radar_proximity_reserve_contacts(proximity, count)) {
+        fprintf(stderr, "Proximity: could not snapshot %d contacts\n", count);
+        return 0;
+    }
+
+    int i = 0;
+    for (const RadarObjectLinkedList *node = radar->radar_objects; node != NULL; node = node->next) {
+        const RadarObject *object = &node->object;
+        if (object->status != RADAR_OBJECT_STATUS_ALIVE || object->type == 0) continue;
+        proximity->rawX[i] = (float) object->x;
+        proximity->rawY[i] = (float) object->y;
+        proximity->rawId[i] = node->id;
+        proximity->rawType[i] = (Sint8) SDL_clamp(object->type, -(RADAR_PROXIMITY_TYPES - 1), RADAR_PROXIMITY_TYPES - 1);
+        i++;
+    }
+    return count;
+}
+
+/**
+ * Lay the grid over the contacts, cells at least as large as the longest leave range so the
+ * 3x3 neighbourhood of a cell holds every candidate, and bucket the contacts with a counting sort.
+ */
+static bool radar_proximity_bucket(RadarProximity *proximity, int count, float reach) {
+    float minX = proximity->rawX[0], maxX = minX;
+    float minY = proximity->rawY[0], maxY = minY;
+    for (int i = 1; i < count; ++i) {
+        minX = SDL_min(minX, proximity->rawX[i]);
+        maxX = SDL_max(maxX, proximity->rawX[i]);
+        minY = SDL_min(minY, proximity->rawY[i]);
+        maxY = SDL_max(maxY, proximity->rawY[i]);
+    }
+
+    // Sparse contacts over a large area: larger cells, so the grid stays proportional to the contacts
+    float cellSize = SDL_max(reach, 1.0f);
+    const double maxCells = (double) RADAR_PROXIMITY_MAX_CELLS_PER_CONTACT * count;
+    const double area = ((double) (maxX - minX) + cellSize) * ((double) (maxY - minY) + cellSize);
+    if (area / ((double) cellSize * cellSize) > maxCells) {
+        cellSize = (float) sqrt(area / maxCells) + 1.0f;
+    }
+    proximity->cellSize = cellSize;
+    proximity->originX = minX;
+    proximity->originY = minY;
+    proximity->columns = (int) ((maxX - minX) / cellSize) + 1;
+    proximity->rows = (int) ((maxY - minY) / cellSize) + 1;
+
+    const int cells = proximity->columns * proximity->rows;
+    const int buckets = 2 * cells;
+    if (buckets + 1 > proximity->bucketCapacity) {
+        if (!radar_proximity_grow((void **) &proximity->bucketStart, sizeof(int), buckets + 1)) return false;
+        proximity->bucketCapacity = buckets + 1;
+    }
+    int *start = proximity->bucketStart;
+    memset(start, 0, sizeof(int) * (buckets + 1));
+    for (int i = 0; i < count; ++i) {
+        const int column = SDL_min((int) ((proximity->rawX[i] - minX) / cellSize), proximity->columns - 1);
+        const int row = SDL_min((int) ((proximity->rawY[i] - minY) / cellSize), proximity->rows - 1);
+        const int bucket = (proximity->rawType[i] > 0 ? cells : 0) + row * proximity->columns + column;
+        proximity->rawBucket[i] = bucket;
+        start[bucket + 1]++;
+    }
+    for (int b = 0; b < buckets; ++b) {
+        start[b + 1] += start[b];
+    }
+    // Scatter, each offset advancing to the start of the next bucket, then shift the offsets back
+    for (int i = 0; i < count; ++i) {
+        const int slot = start[proximity->rawBucket[i]]++;
+        proximity->x[slot] = proximity->rawX[i];
+        proximity->y[slot] = proximity->rawY[i];
+        proximity->id[slot] = proximity->rawId[i];
+        proximity->type[slot] = proximity->rawType[i];
+    }
+    for (int b = buckets; b > 0; --b) {
+        start[b] = start[b - 1];
+    }
+    start[0] = 0;
+    return true;
+}
+
+typedef struct {
+    RadarProximity *proximity;
+    float leaveSquared[RADAR_PROXIMITY_TYPES][RADAR_PROXIMITY_TYPES];
+} RadarProximityJob;
+
+/**
+ * Every enemy of a run of cells against the allies of the 3x3 cells around it.
+ * Buckets hold the enemies of every cell, then the allies of every cell.
+ */
+static void radar_proximity_job(void *context, int index) {
+    const RadarProximityJob *job = context;
+    RadarProximity *proximity = job->proximity;
+    RadarProximityPairList *list = &proximity->jobPairs[index];
+    list->count = 0;
+
+    const int columns = proximity->columns;
+    const int rows = proximity->rows;
+    const int *start = proximity->bucketStart;
+    const float *x = proximity->x;
+    const float *y = proximity->y;
+    const Sint8 *type = proximity->type;
+    const int firstCell = index * proximity->cellsPerJob;
+    const int lastCell = SDL_min(firstCell + proximity->cellsPerJob, columns * rows);
+
+    const int *allyStart = start + columns * rows;
+    for (int cell = firstCell; cell < lastCell; ++cell) {
+        const int enemyStart = start[cell];
+        const int enemyEnd = start[cell + 1];
+        if (enemyStart == enemyEnd) continue;
+        const int column = cell % columns;
+        const int row = cell / columns;
+        const int firstColumn = SDL_max(column - 1, 0);
+        const int lastColumn = SDL_min(column + 1, columns - 1);
+
+        // The allies of three neighbour cells of a row are contiguous
+        for (int neighbourRow = SDL_max(row - 1, 0); neighbourRow <= SDL_min(row + 1, rows - 1); ++neighbourRow) {
+            const int allyFirst = allyStart[neighbourRow * columns + firstColumn];
+            const int allyLast = allyStart[neighbourRow * columns + lastColumn + 1];
+            if (allyFirst == allyLast) continue;
+
+            for (int e = enemyStart; e < enemyEnd; ++e) {
+                const float ex = x[e];
+                const float ey = y[e];
+                const float *leaveSquared = job->leaveSquared[-type[e]];
+                for (int a = allyFirst; a < allyLast; ++a) {
+                    const float dx = x[a] - ex;
+                    const float dy = y[a] - ey;
+                    const float distanceSquared = dx * dx + dy * dy;
+                    if (distanceSquared > leaveSquared[type[a]]) continue;
+                    if (!radar_proximity_reserve(list, list->count + 1)) return;
+                    list->pairs[list->count++] = (RadarProximityPair){
+                        .key = (Uint64) proximity->id[e] << 32 | proximity->id[a],
+                        .distance = sqrtf(distanceSquared),
+                        .enemy = e,
+                        .ally = a,
+                        .enemyType = type[e],
+                        .allyType = type[a]
+                    };
+                }
+            }
+        }
+    }
+}
+
+/**
+ * LSD radix sort of the candidates on their key, one byte per pass; passes where every key has the
+ * same byte (high bytes of small ids) are skipped. The sorted pairs end up in proximity->candidates.
+ */
+static bool radar_proximity_sort(RadarProximity *proximity) {
+    const int count = proximity->candidates.count;
+    if (count < 2) return true;
+    if (!radar_proximity_reserve(&proximity->sortBuffer, count)) return false;
+
+    int histogram[8][256];
+    memset(histogram, 0, sizeof(histogram));
+    const RadarProximityPair *pairs = proximity->candidates.pairs;
+    for (int i = 0; i < count; ++i) {
+        const Uint64 key = pairs[i].key;
+        for (int pass = 0; pass < 8; ++pass) {
+            histogram[pass][(key >> (8 * pass)) & 0xff]++;
+        }
+    }
+
+    RadarProximityPair *source = proximity->candidates.pairs;
+    RadarProximityPair *destination = proximity->sortBuffer.pairs;
+    for (int pass = 0; pass < 8; ++pass) {
+        int *offsets = histogram[pass];
+        if (offsets[(source[0].key >> (8 * pass)) & 0xff] == count) continue;
+        int sum = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            const int digitCount = offsets[digit];
+            offsets[digit] = sum;
+            sum += digitCount;
+        }
+        for (int i = 0; i < count; ++i) {
+            destination[offsets[(source[i].key >> (8 * pass)) & 0xff]++] = source[i];
+        }
+        RadarProximityPair *swap = source;
+        source = destination;
+        destination = swap;
+    }
+
+    if (source != proximity->candidates.pairs) {
+        RadarProximityPairList sorted = proximity->sortBuffer;
+        proximity->sortBuffer = proximity->candidates;
+        proximity->candidates = sorted;
+        proximity->candidates.count = count;
+    }
+    return true;
+}
+
+static void radar_proximity_event(RadarProximity *proximity, RadarProximityEventType type, const RadarProximityPair *pair) {
+    if (proximity->eventCount == proximity->eventCapacity) {
+        const int capacity = proximity->eventCapacity > 0 ? proximity->eventCapacity * 2 : 64;
+        if (!radar_proximity_grow((void **) &proximity->events, sizeof(RadarProximityEvent), capacity)) return;
+        proximity->eventCapacity = capacity;
+    }
+    proximity->events[proximity->eventCount++] = (RadarProximityEvent){
+        .type = type,
+        .enemyId = (Uint32) (pair->key >> 32),
+        .allyId = (Uint32) pair->key,
+        .enemyType = pair->enemyType,
+        .allyType = pair->allyType,
+        .distance = pair->distance
+    };
+}
+
+/**
+ * Walk the sorted candidates and the pairs of the previous update together:
+ * a new candidate within range enters, a previous pair missing from the candidates leaves,
+ * a pair found in both stays in range until it goes beyond the leave range.
+ */
+static void radar_proximity_merge(RadarProximity *proximity) {
+    RadarProximityPairList swap = proximity->previous;
+    proximity->previous = proximity->pairs;
+    proximity->pairs = swap;
+    proximity->pairs.count = 0;
+    proximity->eventCount = 0;
+
+    const RadarProximityPair *candidates = proximity->candidates.pairs;
+    const RadarProximityPair *previous = proximity->previous.pairs;
+    const int candidateCount = proximity->candidates.count;
+    const int previousCount = proximity->previous.count;
+    if (!radar_proximity_reserve(&proximity->pairs, candidateCount)) {
+        fprintf(stderr, "Proximity: could not keep %d pairs\n", candidateCount);
+        return;
+    }
+
+    int i = 0;
+    int j = 0;
+    while (i < candidateCount || j < previousCount) {
+        if (j == previousCount || (i < candidateCount && candidates[i].key < previous[j].key)) {
+            const RadarProximityPair *pair = &candidates[i++];
+            if (pair->distance <= proximity->ranges[-pair->enemyType][pair->allyType]) {
+                proximity->pairs.pairs[proximity->pairs.count++] = *pair;
+                radar_proximity_event(proximity, RADAR_PROXIMITY_ENTER, pair);
+            }
+        } else if (i == candidateCount || previous[j].key < candidates[i].key) {
+            radar_proximity_event(proximity, RADAR_PROXIMITY_LEAVE, &previous[j++]);
+        } else {
+            proximity->pairs.pairs[proximity->pairs.count++] = candidates[i++];
+            j++;
+        }
+    }
+}
+
+/**
+ * Find the enemy - ally pairs within range and the events since the last update.
+ * Call it once per simulation tick, after radar_object_list_anim_update(); proximity->pairs and
+ * proximity->events stay valid until the next update.
+ */
+void radar_proximity_update(RadarProximity *proximity, const Radar *radar) {
+    RadarProximityJob job = {.proximity = proximity};
+    float reach = 0.0f;
+    for (int enemy = 1; enemy < RADAR_PROXIMITY_TYPES; ++enemy) {
+        for (int ally = 1; ally < RADAR_PROXIMITY_TYPES; ++ally) {
+            const float leave = proximity->ranges[enemy][ally] * RADAR_PROXIMITY_LEAVE_RATIO;
+            job.leaveSquared[enemy][ally] = leave > 0.0f ? leave * leave : -1.0f;
+            reach = SDL_max(reach, leave);
+        }
+    }
+
+    proximity->count = radar_proximity_snapshot(proximity, radar);
+    proximity->candidates.count = 0;
+    if (proximity->count > 0 && radar_proximity_bucket(proximity, proximity->count, reach)) {
+        const int cells = proximity->columns * proximity->rows;
+        int jobCount = 1;
+        if (proximity->count >= RADAR_PROXIMITY_PARALLEL_MIN) {
+            jobCount = SDL_min(SDL_min(4 * radar_jobs_thread_count(), RADAR_PROXIMITY_MAX_JOBS), cells);
+        }
+        proximity->cellsPerJob = (cells + jobCount - 1) / jobCount;
+        proximity->jobCount = (cells + proximity->cellsPerJob - 1) / proximity->cellsPerJob;
+        radar_jobs_run(radar_proximity_job, &job, proximity->jobCount);
+
+        int total = 0;
+        for (int i = 0; i < proximity->jobCount; ++i) {
+            total += proximity->jobPairs[i].count;
+        }
+        if (radar_proximity_reserve(&proximity->candidates, total)) {
+            for (int i = 0; i < proximity->jobCount; ++i) {
+                const RadarProximityPairList *list = &proximity->jobPairs[i];
+                memcpy(proximity->candidates.pairs + proximity->candidates.count, list->pairs, sizeof(RadarProximityPair) * list->count);
+                proximity->candidates.count += list->count;
+            }
+        }
+        if (!radar_proximity_sort(proximity)) {
+            fprintf(stderr, "Proximity: could not sort %d pairs\n", total);
+            proximity->candidates.count = 0;
+        }
+    }
+    radar_proximity_merge(proximity);
+}
+
+/**
+ * Engagement cue: a hairline between the enemy and the ally of every pair in range,
+ * skipped when both ends are out of the view
+ */
+void radar_proximity_draw(const RadarProximity *proximity, const Radar *radar, SDL_Color color) {
+    const int centerX = RADAR_CENTER_X(radar);
+    const int centerY = RADAR_CENTER_Y(radar);
+    const Sint64 reachSquared = (Sint64) radar->radius * radar->radius;
+    for (int i = 0; i < proximity->pairs.count; ++i) {
+        const RadarProximityPair *pair = &proximity->pairs.pairs[i];
+        int enemyX, enemyY, allyX, allyY;
+        radar_view_to_scope(radar, proximity->x[pair->enemy], proximity->y[pair->enemy], &enemyX, &enemyY);
+        radar_view_to_scope(radar, proximity->x[pair->ally], proximity->y[pair->ally], &allyX, &allyY);
+        if ((Sint64) enemyX * enemyX + (Sint64) enemyY * enemyY > reachSquared &&
+            (Sint64) allyX * allyX + (Sint64) allyY * allyY > reachSquared) continue;
+        radar_primitive_hairline(radar, centerX + enemyX, centerY + enemyY, centerX + allyX, centerY + allyY, color);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef RADAR_PROXIMITY_H
+#define RADAR_PROXIMITY_H
+#include <SDL2/SDL.h>
+#include "radar.h"
+
+#define RADAR_PROXIMITY_TYPES 9           // |type| of a contact, 1 to 8; row and column 0 are unused
+#define RADAR_PROXIMITY_LEAVE_RATIO 1.1f  // A pair in range leaves it beyond range x ratio, so it does not flicker on the edge
+#define RADAR_PROXIMITY_MAX_CELLS_PER_CONTACT 4 // Cells grow beyond the largest range when the contacts are spread out
+#define RADAR_PROXIMITY_PARALLEL_MIN 2048 // Contacts under which the pairs are searched on the calling thread
+#define RADAR_PROXIMITY_MAX_JOBS 256
+
+typedef enum {
+    RADAR_PROXIMITY_ENTER,
+    RADAR_PROXIMITY_LEAVE
+} RadarProximityEventType;
+
+/**
+ * An enemy and an ally coming within range, or going out of range, during the last update.
+ * Ids are the pool ids of the contacts (RadarObjectLinkedList.id), unique for their life.
+ */
+typedef struct {
+    RadarProximityEventType type;
+    Uint32 enemyId;
+    Uint32 allyId;
+    int enemyType;
+    int allyType;
+    float distance; // At this update for ENTER, at the last update in range for LEAVE
+} RadarProximityEvent;
+
+/**
+ * Enemy - ally pair within range, enemy and ally index the contact snapshot of the last update
+ */
+typedef struct {
+    Uint64 key; // enemyId << 32 | allyId, pairs are sorted on it
+    float distance;
+    int enemy;
+    int ally;
+    Sint8 enemyType;
+    Sint8 allyType;
+} RadarProximityPair;
+
+typedef struct {
+    RadarProximityPair *pairs;
+    int count;
+    int capacity;
+} RadarProximityPairList;
+
+/**
+ * Uniform grid broadphase between enemy and ally contacts.
+ * Each update snapshots the live contacts, counting sorts them by side then grid cell, so the allies of
+ * neighbour cells in a row are contiguous, then every enemy tests the allies of its 3x3 neighbour cells.
+ * Cells are split between the radar_jobs workers, each filling its own pair list; the pairs are
+ * radix sorted on their key and merged with the previous update to produce enter and leave events.
+ * Buffers only grow, an update at a steady contact count does not allocate.
+ */
+struct RadarProximity {
+    float ranges[RADAR_PROXIMITY_TYPES][RADAR_PROXIMITY_TYPES]; // [|enemy type|][ally type], in world units, 0 disables the pair
+    float cellSize;
+    int columns, rows;
+    float originX, originY;
+
+    // Contacts of the last update, sorted by bucket: the enemies cell by cell, then the allies
+    int count;
+    int capacity;
+    float *x, *y;
+    Uint32 *id;
+    Sint8 *type;
+    float *rawX, *rawY; // Same, in list order, before sorting
+    Uint32 *rawId;
+    Sint8 *rawType;
+    int *rawBucket;     // cell, plus the cell count for the allies
+    int *bucketStart;   // 2 * cells + 1 offsets in the sorted arrays
+    int bucketCapacity;
+
+    RadarProximityPairList jobPairs[RADAR_PROXIMITY_MAX_JOBS];
+    int jobCount;
+    int cellsPerJob;
+
+    RadarProximityPairList candidates; // Pairs within the leave range, sorted
+    RadarProximityPairList sortBuffer;
+    RadarProximityPairList pairs;      // Pairs in range after the last update, sorted
+    RadarProximityPairList previous;
+
+    RadarProximityEvent *events;
+    int eventCount;
+    int eventCapacity;
+};
+
+RadarProximity* radar_proximity_create(void);
+void radar_proximity_destroy(RadarProximity *proximity);
+void radar_proximity_set_range(RadarProximity *proximity, int enemyType, int allyType, float range);
+void radar_proximity_update(RadarProximity *proximity, const Radar *radar);
+void radar_proximity_draw(const RadarProximity *proximity, const Radar *radar, SDL_Color color);
+
+#endif
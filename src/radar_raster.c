@@ -0,0 +1,500 @@
+#include "radar.h"
+#include "radar_raster.h"
+#include "radar_jobs.h"
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* ---- Blending (SDL_BLENDMODE_BLEND on RGBA8888) ---- */
+
+static inline Uint32 div255(Uint32 value) {
+    value += 128;
+    return (value + (value >> 8)) >> 8;
+}
+
+/**
+ * dst.rgb = src.rgb * alpha + dst.rgb * (1 - alpha), dst.a = alpha + dst.a * (1 - alpha)
+ */
+static inline Uint32 blend_pixel(Uint32 dst, Uint32 color, Uint32 alpha) {
+    Uint32 inverse = 255 - alpha;
+    Uint32 r = div255(((color >> 24) & 0xFF) * alpha + ((dst >> 24) & 0xFF) * inverse);
+    Uint32 g = div255(((color >> 16) & 0xFF) * alpha + ((dst >> 16) & 0xFF) * inverse);
+    Uint32 b = div255(((color >> 8) & 0xFF) * alpha + ((dst >> 8) & 0xFF) * inverse);
+    Uint32 a = div255(255 * alpha + (dst & 0xFF) * inverse);
+    return (r << 24) | (g << 16) | (b << 8) | a;
+}
+
+/**
+ * Blend a constant color over a span, 4 pixels per iteration with SSE2.
+ */
+static void blend_span(Uint32 *dst, int count, Uint32 color, Uint32 alpha) {
+    if (alpha == 0 || count <= 0) return;
+    if (alpha == 255) {
+        Uint32 opaque = color | 0xFF;
+        for (int i = 0; i < count; ++i) {
+            dst[i] = opaque;
+        }
+        return;
+    }
+
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i source = _mm_unpacklo_epi8(_mm_set1_epi32((int)(color | 0xFF)), zero);
+    const __m128i sourceTerm = _mm_add_epi16(_mm_mullo_epi16(source, _mm_set1_epi16((short) alpha)), _mm_set1_epi16(128));
+    const __m128i inverse = _mm_set1_epi16((short)(255 - alpha));
+    for (; i + 4 <= count; i += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), inverse), sourceTerm);
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), inverse), sourceTerm);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = blend_pixel(dst[i], color, alpha);
+    }
+}
+
+static inline void blend_coverage(Uint32 *dst, Uint32 color, float coverage) {
+    if (coverage <= 0.0f) return;
+    if (coverage > 1.0f) coverage = 1.0f;
+    Uint32 alpha = (Uint32)((color & 0xFF) * coverage + 0.5f);
+    if (alpha > 0) {
+        *dst = blend_pixel(*dst, color, alpha);
+    }
+}
+
+/* ---- Raster lifecycle ---- */
+
+/**
+ * Raster of width x height pixels drawing into pixels, or into its own buffer when pixels is NULL.
+ * A provided buffer stays owned by the caller (e.g. carved from the radar arena).
+ */
+RadarRaster* radar_raster_create(int width, int height, Uint32 *pixels) {
+    RadarRaster *raster = calloc(1, sizeof(RadarRaster));
+    if (raster == NULL) return NULL;
+
+    raster->externalPixels = pixels != NULL;
+    raster->ownedPixels = pixels != NULL ? pixels : calloc((size_t) width * height, sizeof(Uint32));
+    if (raster->ownedPixels == NULL) {
+        free(raster);
+        return NULL;
+    }
+    raster->ownedWidth = width;
+    raster->ownedHeight = height;
+    radar_raster_bind(raster, raster->ownedPixels, width, height, width, NULL);
+    return raster;
+}
+
+void radar_raster_destroy(RadarRaster *raster) {
+    if (raster == NULL) return;
+    if (!raster->externalPixels) {
+        free(raster->ownedPixels);
+    }
+    free(raster->commands);
+    free(raster->binOffsets);
+    free(raster->binCursors);
+    free(raster->binCommands);
+    free(raster);
+}
+
+/**
+ * Draw into another buffer (pitch in pixels) until radar_raster_unbind(), e.g. a caller owned frame.
+ * Drawing is limited to the clip rectangle, or to the whole buffer when clip is NULL.
+ */
+void radar_raster_bind(RadarRaster *raster, Uint32 *pixels, int width, int height, int pitch, const SDL_Rect *clip) {
+    raster->pixels = pixels;
+    raster->width = width;
+    raster->height = height;
+    raster->pitch = pitch;
+    SDL_Rect full = {0, 0, width, height};
+    if (clip == NULL || !SDL_IntersectRect(clip, &full, &raster->clip)) {
+        raster->clip = clip == NULL ? full : (SDL_Rect){0, 0, 0, 0};
+    }
+}
+
+void radar_raster_unbind(RadarRaster *raster) {
+    radar_raster_bind(raster, raster->ownedPixels, raster->ownedWidth, raster->ownedHeight, raster->ownedWidth, NULL);
+}
+
+void radar_raster_clear(RadarRaster *raster, Uint32 color) {
+    raster->commandCount = 0;
+    for (int y = raster->clip.y; y < raster->clip.y + raster->clip.h; ++y) {
+        Uint32 *row = raster->pixels + (size_t) y * raster->pitch + raster->clip.x;
+        if (color == 0) {
+            memset(row, 0, sizeof(Uint32) * raster->clip.w);
+        } else {
+            for (int x = 0; x < raster->clip.w; ++x) {
+                row[x] = color;
+            }
+        }
+    }
+}
+
+/* ---- Recording ---- */
+
+static RadarRasterCommand* raster_push(RadarRaster *raster, RadarRasterCommandType type, Uint32 color,
+                                       int x1, int y1, int x2, int y2) {
+    SDL_Rect bounds = {x1, y1, x2 - x1 + 1, y2 - y1 + 1};
+    SDL_Rect clipped;
+    if ((color & 0xFF) == 0 && type != RADAR_RASTER_LAYER) return NULL;
+    if (!SDL_IntersectRect(&bounds, &raster->clip, &clipped)) return NULL;
+
+    if (raster->commandCount == raster->commandCapacity) {
+        int capacity = raster->commandCapacity ? raster->commandCapacity * 2 : 1024;
+        RadarRasterCommand *commands = realloc(raster->commands, sizeof(RadarRasterCommand) * capacity);
+        if (commands == NULL) {
+            fprintf(stderr, "Radar raster: out of memory for %d commands\n", capacity);
+            return NULL;
+        }
+        raster->commands = commands;
+        raster->commandCapacity = capacity;
+    }
+
+    RadarRasterCommand *command = &raster->commands[raster->commandCount++];
+    command->type = type;
+    command->color = color;
+    command->bounds = clipped;
+    return command;
+}
+
+void radar_raster_hairline(RadarRaster *raster, int x1, int y1, int x2, int y2, Uint32 color) {
+    RadarRasterCommand *command = raster_push(raster, RADAR_RASTER_HAIRLINE, color,
+        SDL_min(x1, x2), SDL_min(y1, y2), SDL_max(x1, x2), SDL_max(y1, y2));
+    if (command == NULL) return;
+    command->line.x1 = x1;
+    command->line.y1 = y1;
+    command->line.x2 = x2;
+    command->line.y2 = y2;
+    command->line.width = 1.0f;
+}
+
+void radar_raster_line(RadarRaster *raster, float x1, float y1, float x2, float y2, float width, Uint32 color) {
+    float reach = SDL_max(width, 1.0f) / 2.0f + 1.0f;
+    RadarRasterCommand *command = raster_push(raster, RADAR_RASTER_LINE, color,
+        (int) floorf(SDL_min(x1, x2) - reach), (int) floorf(SDL_min(y1, y2) - reach),
+        (int) ceilf(SDL_max(x1, x2) + reach), (int) ceilf(SDL_max(y1, y2) + reach));
+    if (command == NULL) return;
+    command->line.x1 = x1;
+    command->line.y1 = y1;
+    command->line.x2 = x2;
+    command->line.y2 = y2;
+    command->line.width = SDL_max(width, 1.0f);
+}
+
+void radar_raster_ring(RadarRaster *raster, int x, int y, int radius, Uint32 color) {
+    RadarRasterCommand *command = raster_push(raster, RADAR_RASTER_RING, color,
+        x - radius - 1, y - radius - 1, x + radius + 1, y + radius + 1);
+    if (command == NULL) return;
+    command->circle.x = x;
+    command->circle.y = y;
+    command->circle.radius = radius;
+}
+
+void radar_raster_filled_circle(RadarRaster *raster, int x, int y, int radius, Uint32 color) {
+    RadarRasterCommand *command = raster_push(raster, RADAR_RASTER_FILLED_CIRCLE, color,
+        x - radius, y - radius, x + radius, y + radius);
+    if (command == NULL) return;
+    command->circle.x = x;
+    command->circle.y = y;
+    command->circle.radius = radius;
+}
+
+void radar_raster_rounded_box(RadarRaster *raster, int x1, int y1, int x2, int y2, int corner, Uint32 color) {
+    RadarRasterCommand *command = raster_push(raster, RADAR_RASTER_ROUNDED_BOX, color,
+        SDL_min(x1, x2), SDL_min(y1, y2), SDL_max(x1, x2), SDL_max(y1, y2));
+    if (command == NULL) return;
+    command->box.x1 = SDL_min(x1, x2);
+    command->box.y1 = SDL_min(y1, y2);
+    command->box.x2 = SDL_max(x1, x2);
+    command->box.y2 = SDL_max(y1, y2);
+    command->box.corner = SDL_min(corner, SDL_min(command->box.x2 - command->box.x1, command->box.y2 - command->box.y1) / 2);
+}
+
+/**
+ * Blend a w*h RGBA8888 image (pitch w) with its own alpha, e.g. a baked static layer.
+ */
+void radar_raster_layer(RadarRaster *raster, const Uint32 *pixels, int x, int y, int w, int h) {
+    RadarRasterCommand *command = raster_push(raster, RADAR_RASTER_LAYER, 0, x, y, x + w - 1, y + h - 1);
+    if (command == NULL) return;
+    command->layer.pixels = pixels;
+    command->layer.x = x;
+    command->layer.y = y;
+    command->layer.w = w;
+    command->layer.h = h;
+}
+
+/* ---- Rasterization, every routine only touches pixels inside area ---- */
+
+static inline Uint32* raster_row(const RadarRaster *raster, int y) {
+    return raster->pixels + (size_t) y * raster->pitch;
+}
+
+static void raster_span(const RadarRaster *raster, const SDL_Rect *area, int y, int x1, int x2, Uint32 color) {
+    if (y < area->y || y >= area->y + area->h) return;
+    x1 = SDL_max(x1, area->x);
+    x2 = SDL_min(x2, area->x + area->w - 1);
+    if (x2 < x1) return;
+    blend_span(raster_row(raster, y) + x1, x2 - x1 + 1, color, color & 0xFF);
+}
+
+static void raster_draw_hairline(const RadarRaster *raster, const RadarRasterCommand *command, const SDL_Rect *area) {
+    int x1 = (int) command->line.x1, y1 = (int) command->line.y1;
+    int x2 = (int) command->line.x2, y2 = (int) command->line.y2;
+
+    if (y1 == y2) {
+        raster_span(raster, area, y1, SDL_min(x1, x2), SDL_max(x1, x2), command->color);
+        return;
+    }
+    if (x1 == x2) {
+        if (x1 < area->x || x1 >= area->x + area->w) return;
+        int yStart = SDL_max(SDL_min(y1, y2), area->y);
+        int yEnd = SDL_min(SDL_max(y1, y2), area->y + area->h - 1);
+        for (int y = yStart; y <= yEnd; ++y) {
+            Uint32 *pixel = raster_row(raster, y) + x1;
+            *pixel = blend_pixel(*pixel, command->color, command->color & 0xFF);
+        }
+        return;
+    }
+
+    // DDA for the other lines
+    int steps = SDL_max(abs(x2 - x1), abs(y2 - y1));
+    float stepX = (float)(x2 - x1) / steps;
+    float stepY = (float)(y2 - y1) / steps;
+    for (int i = 0; i <= steps; ++i) {
+        int x = (int) lroundf(x1 + stepX * i);
+        int y = (int) lroundf(y1 + stepY * i);
+        if (x < area->x || y < area->y || x >= area->x + area->w || y >= area->y + area->h) continue;
+        Uint32 *pixel = raster_row(raster, y) + x;
+        *pixel = blend_pixel(*pixel, command->color, command->color & 0xFF);
+    }
+}
+
+/**
+ * Coverage based thick line: every pixel close to the segment gets the coverage of its distance
+ * to the segment, scanned row by row on the span crossed by the line.
+ */
+static void raster_draw_line(const RadarRaster *raster, const RadarRasterCommand *command, const SDL_Rect *area) {
+    const float x1 = command->line.x1, y1 = command->line.y1;
+    const float x2 = command->line.x2, y2 = command->line.y2;
+    const float half = command->line.width / 2.0f;
+    const float reach = half + 0.5f;
+    const float dx = x2 - x1, dy = y2 - y1;
+    const float length2 = dx * dx + dy * dy;
+    const float length = sqrtf(length2);
+    const float minX = SDL_min(x1, x2) - reach, maxX = SDL_max(x1, x2) + reach;
+
+    int yStart = SDL_max(command->bounds.y, area->y);
+    int yEnd = SDL_min(command->bounds.y + command->bounds.h, area->y + area->h) - 1;
+    for (int y = yStart; y <= yEnd; ++y) {
+        const float py = (float) y;
+        float spanStart = minX, spanEnd = maxX;
+        if (fabsf(dy) > 1e-3f) {
+            float crossing = x1 + (py - y1) * dx / dy;
+            float spanHalf = reach * length / fabsf(dy);
+            spanStart = SDL_max(spanStart, crossing - spanHalf);
+            spanEnd = SDL_min(spanEnd, crossing + spanHalf);
+        }
+        int xStart = SDL_max((int) floorf(spanStart), area->x);
+        int xEnd = SDL_min((int) ceilf(spanEnd), area->x + area->w - 1);
+
+        Uint32 *row = raster_row(raster, y);
+        for (int x = xStart; x <= xEnd; ++x) {
+            const float px = (float) x;
+            float t = length2 > 0.0f ? ((px - x1) * dx + (py - y1) * dy) / length2 : 0.0f;
+            t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+            float ex = px - (x1 + t * dx);
+            float ey = py - (y1 + t * dy);
+            blend_coverage(&row[x], command->color, reach - sqrtf(ex * ex + ey * ey));
+        }
+    }
+}
+
+/**
+ * Analytic anti-aliased ring of one pixel: coverage = 1 - |distance - radius|, only visiting the
+ * spans between the radius-1 and radius+1 circles.
+ */
+static void raster_draw_ring(const RadarRaster *raster, const RadarRasterCommand *command, const SDL_Rect *area) {
+    const int cx = command->circle.x, cy = command->circle.y;
+    const float radius = (float) command->circle.radius;
+    const float outer2 = (radius + 1.0f) * (radius + 1.0f);
+    const float inner2 = (radius - 1.0f) * (radius - 1.0f);
+
+    int yStart = SDL_max(command->bounds.y, area->y);
+    int yEnd = SDL_min(command->bounds.y + command->bounds.h, area->y + area->h) - 1;
+    for (int y = yStart; y <= yEnd; ++y) {
+        const float dy = (float)(y - cy);
+        const float dy2 = dy * dy;
+        if (dy2 > outer2) continue;
+        int outer = (int) ceilf(sqrtf(outer2 - dy2));
+        int inner = radius > 1.0f && dy2 < inner2 ? (int) floorf(sqrtf(inner2 - dy2)) : -1;
+
+        Uint32 *row = raster_row(raster, y);
+        for (int side = 0; side < 2; ++side) {
+            int xStart = side == 0 ? cx - outer : (inner < 0 ? cx + 1 : cx + inner);
+            int xEnd = side == 0 ? (inner < 0 ? cx : cx - inner) : cx + outer;
+            xStart = SDL_max(xStart, area->x);
+            xEnd = SDL_min(xEnd, area->x + area->w - 1);
+            for (int x = xStart; x <= xEnd; ++x) {
+                const float dx = (float)(x - cx);
+                blend_coverage(&row[x], command->color, 1.0f - fabsf(sqrtf(dx * dx + dy2) - radius));
+            }
+        }
+    }
+}
+
+static void raster_draw_filled_circle(const RadarRaster *raster, const RadarRasterCommand *command, const SDL_Rect *area) {
+    const int cx = command->circle.x, cy = command->circle.y, radius = command->circle.radius;
+    int yStart = SDL_max(command->bounds.y, area->y);
+    int yEnd = SDL_min(command->bounds.y + command->bounds.h, area->y + area->h) - 1;
+    for (int y = yStart; y <= yEnd; ++y) {
+        int dy = y - cy;
+        int half = (int) sqrtf((float)(radius * radius - dy * dy));
+        raster_span(raster, area, y, cx - half, cx + half, command->color);
+    }
+}
+
+static void raster_draw_rounded_box(const RadarRaster *raster, const RadarRasterCommand *command, const SDL_Rect *area) {
+    const int corner = command->box.corner;
+    int yStart = SDL_max(command->bounds.y, area->y);
+    int yEnd = SDL_min(command->bounds.y + command->bounds.h, area->y + area->h) - 1;
+    for (int y = yStart; y <= yEnd; ++y) {
+        int inset = 0;
+        int dy = 0;
+        if (y < command->box.y1 + corner) dy = command->box.y1 + corner - y;
+        else if (y > command->box.y2 - corner) dy = y - (command->box.y2 - corner);
+        if (dy > 0) {
+            inset = corner - (int) sqrtf((float)(corner * corner - dy * dy));
+        }
+        raster_span(raster, area, y, command->box.x1 + inset, command->box.x2 - inset, command->color);
+    }
+}
+
+static void raster_draw_layer(const RadarRaster *raster, const RadarRasterCommand *command, const SDL_Rect *area) {
+    int yStart = SDL_max(command->bounds.y, area->y);
+    int yEnd = SDL_min(command->bounds.y + command->bounds.h, area->y + area->h) - 1;
+    int xStart = SDL_max(command->bounds.x, area->x);
+    int xEnd = SDL_min(command->bounds.x + command->bounds.w, area->x + area->w) - 1;
+    for (int y = yStart; y <= yEnd; ++y) {
+        const Uint32 *source = command->layer.pixels + (size_t)(y - command->layer.y) * command->layer.w;
+        Uint32 *row = raster_row(raster, y);
+        for (int x = xStart; x <= xEnd; ++x) {
+            Uint32 pixel = source[x - command->layer.x];
+            Uint32 alpha = pixel & 0xFF;
+            if (alpha == 0) continue;
+            row[x] = alpha == 255 ? pixel : blend_pixel(row[x], pixel, alpha);
+        }
+    }
+}
+
+/* ---- Flush ---- */
+
+static void raster_band_job(void *context, int band) {
+    const RadarRaster *raster = context;
+    SDL_Rect area = {
+        raster->clip.x,
+        raster->clip.y + band * RADAR_RASTER_BAND_HEIGHT,
+        raster->clip.w,
+        SDL_min(RADAR_RASTER_BAND_HEIGHT, raster->clip.y + raster->clip.h - (raster->clip.y + band * RADAR_RASTER_BAND_HEIGHT))
+    };
+
+    for (int i = raster->binOffsets[band]; i < raster->binOffsets[band + 1]; ++i) {
+        const RadarRasterCommand *command = &raster->commands[raster->binCommands[i]];
+        switch (command->type) {
+            case RADAR_RASTER_HAIRLINE: raster_draw_hairline(raster, command, &area); break;
+            case RADAR_RASTER_LINE: raster_draw_line(raster, command, &area); break;
+            case RADAR_RASTER_RING: raster_draw_ring(raster, command, &area); break;
+            case RADAR_RASTER_FILLED_CIRCLE: raster_draw_filled_circle(raster, command, &area); break;
+            case RADAR_RASTER_ROUNDED_BOX: raster_draw_rounded_box(raster, command, &area); break;
+            case RADAR_RASTER_LAYER: raster_draw_layer(raster, command, &area); break;
+        }
+    }
+}
+
+static int raster_grow_bins(RadarRaster *raster, int bandCount, int binCommandCount) {
+    if (bandCount + 1 > raster->binCapacity) {
+        int *offsets = realloc(raster->binOffsets, sizeof(int) * (bandCount + 1));
+        if (offsets == NULL) return -1;
+        raster->binOffsets = offsets;
+        int *cursors = realloc(raster->binCursors, sizeof(int) * (bandCount + 1));
+        if (cursors == NULL) return -1;
+        raster->binCursors = cursors;
+        raster->binCapacity = bandCount + 1;
+    }
+    if (binCommandCount > raster->binCommandCapacity) {
+        int capacity = SDL_max(binCommandCount, raster->binCommandCapacity * 2);
+        int *binCommands = realloc(raster->binCommands, sizeof(int) * capacity);
+        if (binCommands == NULL) return -1;
+        raster->binCommands = binCommands;
+        raster->binCommandCapacity = capacity;
+    }
+    return 0;
+}
+
+/**
+ * Rasterize every recorded primitive. Commands are binned per band (counting sort, recording order
+ * kept inside each band) and the bands are spread over the worker pool.
+ */
+void radar_raster_flush(RadarRaster *raster) {
+    if (raster->commandCount == 0 || raster->clip.h <= 0) {
+        raster->commandCount = 0;
+        return;
+    }
+
+    const int bandCount = (raster->clip.h + RADAR_RASTER_BAND_HEIGHT - 1) / RADAR_RASTER_BAND_HEIGHT;
+    if (raster_grow_bins(raster, bandCount, 0) != 0) {
+        fprintf(stderr, "Radar raster: out of memory for %d bands\n", bandCount);
+        raster->commandCount = 0;
+        return;
+    }
+
+    memset(raster->binCursors, 0, sizeof(int) * (bandCount + 1));
+    for (int i = 0; i < raster->commandCount; ++i) {
+        const SDL_Rect *bounds = &raster->commands[i].bounds;
+        int first = (bounds->y - raster->clip.y) / RADAR_RASTER_BAND_HEIGHT;
+        int last = (bounds->y + bounds->h - 1 - raster->clip.y) / RADAR_RASTER_BAND_HEIGHT;
+        for (int band = first; band <= last; ++band) {
+            raster->binCursors[band]++;
+        }
+    }
+
+    int total = 0;
+    for (int band = 0; band < bandCount; ++band) {
+        raster->binOffsets[band] = total;
+        total += raster->binCursors[band];
+        raster->binCursors[band] = raster->binOffsets[band];
+    }
+    raster->binOffsets[bandCount] = total;
+
+    if (raster_grow_bins(raster, bandCount, total) != 0) {
+        fprintf(stderr, "Radar raster: out of memory for %d binned commands\n", total);
+        raster->commandCount = 0;
+        return;
+    }
+
+    for (int i = 0; i < raster->commandCount; ++i) {
+        const SDL_Rect *bounds = &raster->commands[i].bounds;
+        int first = (bounds->y - raster->clip.y) / RADAR_RASTER_BAND_HEIGHT;
+        int last = (bounds->y + bounds->h - 1 - raster->clip.y) / RADAR_RASTER_BAND_HEIGHT;
+        for (int band = first; band <= last; ++band) {
+            raster->binCommands[raster->binCursors[band]++] = i;
+        }
+    }
+    raster->bandCount = bandCount;
+
+    if (raster->commandCount < RADAR_RASTER_PARALLEL_MIN) {
+        for (int band = 0; band < bandCount; ++band) {
+            raster_band_job(raster, band);
+        }
+    } else {
+        radar_jobs_run(raster_band_job, raster, bandCount);
+    }
+    raster->commandCount = 0;
+}
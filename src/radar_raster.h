@@ -0,0 +1,74 @@
+#ifndef RADAR_RASTER_H
+#define RADAR_RASTER_H
+#include <SDL2/SDL.h>
+#include "radar.h"
+
+#define RADAR_RASTER_BAND_HEIGHT 32 // Rows per tile, one job per band when flushing
+#define RADAR_RASTER_PARALLEL_MIN 64 // Below this number of commands the flush stays on the calling thread
+
+/**
+ * Pixels are RGBA8888 (R in the high byte, A in the low byte), the format of the working texture,
+ * so the buffer can be uploaded as is or sampled by the sphere projection.
+ */
+#define RADAR_RASTER_RGBA(c) (((Uint32)(c).r << 24) | ((Uint32)(c).g << 16) | ((Uint32)(c).b << 8) | (Uint32)(c).a)
+
+typedef enum {
+    RADAR_RASTER_HAIRLINE,
+    RADAR_RASTER_LINE,
+    RADAR_RASTER_RING,
+    RADAR_RASTER_FILLED_CIRCLE,
+    RADAR_RASTER_ROUNDED_BOX,
+    RADAR_RASTER_LAYER
+} RadarRasterCommandType;
+
+typedef struct {
+    RadarRasterCommandType type;
+    Uint32 color;
+    SDL_Rect bounds;
+    union {
+        struct { float x1, y1, x2, y2, width; } line;
+        struct { int x, y, radius; } circle;
+        struct { int x1, y1, x2, y2, corner; } box;
+        struct { const Uint32 *pixels; int x, y, w, h; } layer;
+    };
+} RadarRasterCommand;
+
+/**
+ * CPU rasterizer of the scope primitives.
+ * Primitives are recorded, binned into horizontal bands on flush and each band is rasterized by the
+ * worker pool, in recording order, so the result does not depend on the number of threads.
+ */
+struct RadarRaster {
+    Uint32 *pixels;
+    int width, height;
+    int pitch; // In pixels
+    Uint32 *ownedPixels;
+    int ownedWidth, ownedHeight;
+    bool externalPixels; // ownedPixels given at creation, not freed with the raster
+    SDL_Rect clip;
+    RadarRasterCommand *commands;
+    int commandCount;
+    int commandCapacity;
+    int *binOffsets;
+    int *binCursors;
+    int binCapacity;
+    int *binCommands;
+    int binCommandCapacity;
+    int bandCount;
+};
+
+RadarRaster* radar_raster_create(int width, int height, Uint32 *pixels);
+void radar_raster_destroy(RadarRaster *raster);
+void radar_raster_bind(RadarRaster *raster, Uint32 *pixels, int width, int height, int pitch, const SDL_Rect *clip);
+void radar_raster_unbind(RadarRaster *raster);
+void radar_raster_clear(RadarRaster *raster, Uint32 color);
+
+void radar_raster_hairline(RadarRaster *raster, int x1, int y1, int x2, int y2, Uint32 color);
+void radar_raster_line(RadarRaster *raster, float x1, float y1, float x2, float y2, float width, Uint32 color);
+void radar_raster_ring(RadarRaster *raster, int x, int y, int radius, Uint32 color);
+void radar_raster_filled_circle(RadarRaster *raster, int x, int y, int radius, Uint32 color);
+void radar_raster_rounded_box(RadarRaster *raster, int x1, int y1, int x2, int y2, int corner, Uint32 color);
+void radar_raster_layer(RadarRaster *raster, const Uint32 *pixels, int x, int y, int w, int h);
+void radar_raster_flush(RadarRaster *raster);
+
+#endif
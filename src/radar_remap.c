@@ -0,0 +1,247 @@
+#include "radar_remap.h"
+#include "radar_cache.h"
+#include "radar_raster.h"
+#include "radar_sphere.h"
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Index of the working texture pixel at (x, y), -1 when it falls outside
+static inline Sint32 radar_remap_index(float x, float y, int width, int height) {
+    int sx = (int) floorf(x + 0.5f);
+    int sy = (int) floorf(y + 0.5f);
+    if (sx < 0 || sy < 0 || sx >= width || sy >= height) return -1;
+    return sy * width + sx;
+}
+
+/**
+ * Columns sweep the bearings clockwise from north, rows the range from the edge (top) to the center (bottom).
+ */
+static void radar_remap_build_b_scope(Sint32 *lookup, int width, int height, int radius, int padding) {
+    const float center = (float) (padding + radius);
+    for (int x = 0; x < width; ++x) {
+        const double bearing = (-90.0 + 360.0 * (x + 0.5) / width) * M_PI / 180.0;
+        const float c = (float) cos(bearing);
+        const float s = (float) sin(bearing);
+        for (int y = 0; y < height; ++y) {
+            const float range = radius * (height - 0.5f - y) / height;
+            lookup[y * width + x] = radar_remap_index(center + c * range, center + s * range, width, height);
+        }
+    }
+}
+
+/**
+ * The apex of the sector sits at the bottom center of the view and its arc touches the top or the sides,
+ * whichever comes first.
+ */
+static void radar_remap_build_sector(Sint32 *lookup, int width, int height, int radius, int padding,
+                                     float sectorCenter, float sectorWidth) {
+    const float center = (float) (padding + radius);
+    const double half = sectorWidth * M_PI / 360.0;
+    const float apexX = width / 2.0f;
+    const float apexY = (float) height;
+    const float viewRadius = (float) SDL_min((double) height, apexX / sin(SDL_min(half, M_PI / 2.0)));
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const float dx = x + 0.5f - apexX;
+            const float dy = apexY - (y + 0.5f);
+            const double theta = atan2(dx, dy); // 0 straight up, positive to the right (clockwise)
+            const float distance = sqrtf(dx * dx + dy * dy) / viewRadius;
+            if (fabs(theta) > half || distance > 1.0f) {
+                lookup[y * width + x] = -1;
+                continue;
+            }
+            const double bearing = sectorCenter * M_PI / 180.0 + theta;
+            const float range = distance * radius;
+            lookup[y * width + x] = radar_remap_index(
+                center + (float) cos(bearing) * range, center + (float) sin(bearing) * range, width, height);
+        }
+    }
+}
+
+/**
+ * Whether every index of a table of count pixels samples the working texture of the same size, or is -1
+ */
+static bool radar_remap_lookup_valid(const Sint32 *lookup, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (lookup[i] < -1 || lookup[i] >= count) return false;
+    }
+    return true;
+}
+
+/**
+ * Remap table of a display mode: for each pixel of the rendered texture, the index of the pixel to
+ * sample in the working texture or -1 for a transparent pixel.
+ * Tables only depend on the geometry and the mode parameters, they are built once and shared by
+ * every radar through the cache; parameters a mode does not use are left out of the key.
+ */
+const Sint32* radar_remap_lookup(Radar *radar, const RadarDisplay *display, int width, int height) {
+    struct {
+        RadarDisplayMode mode;
+        int width, height, radius, padding;
+        float angle_y, angle_x;
+        float sectorCenter, sectorWidth;
+    } key;
+    memset(&key, 0, sizeof(key));
+    key.mode = display->mode;
+    key.width = width;
+    key.height = height;
+    key.radius = radar->radius;
+    key.padding = radar->padding;
+    if (display->mode == RADAR_DISPLAY_SPHERE) {
+        key.angle_y = display->angle_y;
+        key.angle_x = display->angle_x;
+    } else if (display->mode == RADAR_DISPLAY_SECTOR) {
+        key.sectorCenter = fmodf(display->sectorCenter, 360.0f);
+        key.sectorWidth = SDL_clamp(display->sectorWidth, RADAR_SECTOR_MIN_WIDTH, RADAR_SECTOR_MAX_WIDTH);
+    }
+
+    if (radar->remapLookup != NULL && memcmp(radar->remapLookup->key, &key, sizeof(key)) != 0) {
+        radar_cache_release(radar->remapLookup);
+        radar->remapLookup = NULL;
+    }
+    if (radar->remapLookup == NULL) {
+        radar->remapLookup = radar_cache_acquire(RADAR_CACHE_REMAP, NULL, &key, sizeof(key));
+        if (radar->remapLookup == NULL) return NULL;
+        // A table from the cache file must cover the texture and only point into it
+        RadarCacheEntry *entry = radar->remapLookup;
+        if (entry->mapped && radar_cache_has_data(entry, sizeof(Sint32) * width * height) &&
+            !radar_remap_lookup_valid(entry->data, width * height)) {
+            radar_cache_drop_mapped(entry);
+        }
+    }
+    if (radar->remapLookup->data != NULL) {
+        return radar->remapLookup->data;
+    }
+
+    Sint32 *lookup = malloc(sizeof(Sint32) * width * height);
+    if (lookup == NULL) return NULL;
+
+    switch (display->mode) {
+        case RADAR_DISPLAY_SPHERE:
+            radar_sphere_build_lookup(lookup, width, height, radar->radius, key.angle_y, key.angle_x);
+            break;
+        case RADAR_DISPLAY_B_SCOPE:
+            radar_remap_build_b_scope(lookup, width, height, radar->radius, radar->padding);
+            break;
+        case RADAR_DISPLAY_SECTOR:
+            radar_remap_build_sector(lookup, width, height, radar->radius, radar->padding, key.sectorCenter, key.sectorWidth);
+            break;
+        default:
+            // PPI: identity
+            for (int i = 0; i < width * height; ++i) {
+                lookup[i] = i;
+            }
+            break;
+    }
+
+    radar->remapLookup->data = lookup;
+    radar->remapLookup->dataSize = sizeof(Sint32) * width * height;
+    return lookup;
+}
+
+/**
+ * pixels[y][x] = source[lookup[y * width + x]], transparent where the lookup is -1.
+ * Eight pixels per AVX2 gather when built for it (-DRADAR_NATIVE=ON on a capable CPU).
+ */
+void radar_remap_gather(const Sint32 *lookup, const Uint32 *source, void *pixels, int pitch, int width, int height) {
+    for (int y = 0; y < height; ++y) {
+        Uint32 *row = (Uint32 *) ((Uint8 *) pixels + (size_t) y * pitch);
+        const Sint32 *lookupRow = lookup + (size_t) y * width;
+        int x = 0;
+#ifdef __AVX2__
+        const __m256i outside = _mm256_set1_epi32(-1);
+        for (; x + 8 <= width; x += 8) {
+            __m256i index = _mm256_loadu_si256((const __m256i *) (lookupRow + x));
+            __m256i inside = _mm256_cmpgt_epi32(index, outside);
+            __m256i texel = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *) source, index, inside, 4);
+            _mm256_storeu_si256((__m256i *) (row + x), texel);
+        }
+#endif
+        for (; x < width; ++x) {
+            Sint32 index = lookupRow[x];
+            row[x] = index >= 0 ? source[index] : 0;
+        }
+    }
+}
+
+/**
+ * Render the scope in the display mode into radar->renderedTexture, which radar_render() then shows
+ * instead of the working texture. PPI drops the rendered texture and shows the working texture as is.
+ * Only the gather runs per frame, the table is rebuilt when the mode or the geometry changes.
+ */
+void radar_remap_render(Radar *radar, const RadarDisplay *display) {
+    if (display->mode == RADAR_DISPLAY_PPI) {
+        if (radar->renderedTexture != NULL) {
+            SDL_DestroyTexture(radar->renderedTexture);
+            radar->renderedTexture = NULL;
+        }
+        return;
+    }
+
+    SDL_Renderer* radar_renderer = radar->renderer;
+
+    int tWidth, tHeight;
+    SDL_QueryTexture(radar->workingTexture, NULL, NULL, &tWidth, &tHeight);
+
+    const Sint32 *lookup = radar_remap_lookup(radar, display, tWidth, tHeight);
+    if (lookup == NULL) {
+        fprintf(stderr, "Could not build the %s remap table\n", radar_remap_mode_name(display->mode));
+        return;
+    }
+
+    if (radar->renderedTexture == NULL) {
+        radar->renderedTexture = SDL_CreateTexture(radar_renderer, SDL_PIXELFORMAT_RGBA8888,
+                                                   SDL_TEXTUREACCESS_STREAMING, tWidth, tHeight);
+        if (!radar->renderedTexture) {
+            fprintf(stderr, "Could not create display texture: %s\n", SDL_GetError());
+            return;
+        }
+        SDL_SetTextureBlendMode(radar->renderedTexture, SDL_BLENDMODE_BLEND);
+    }
+    const Uint32 *source;
+    if (radar->backend == RADAR_BACKEND_CPU) {
+        // The raster already holds the scope in the working texture format, no read back
+        source = radar->raster->ownedPixels;
+    } else {
+        // Carved from the radar arena at init, the size of the working texture
+        if (radar->remapPixels == NULL) {
+            fprintf(stderr, "No read back buffer for the display remap\n");
+            return;
+        }
+
+        // READ from the working texture
+        SDL_SetRenderTarget(radar_renderer, radar->workingTexture);
+        SDL_RenderReadPixels(
+            radar_renderer, NULL, SDL_PIXELFORMAT_RGBA8888, radar->remapPixels, tWidth * (int) sizeof(Uint32)
+        );
+        SDL_SetRenderTarget(radar_renderer, NULL);
+        source = radar->remapPixels;
+    }
+
+    // WRITE the remapped scope straight in the streaming texture
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(radar->renderedTexture, NULL, &pixels, &pitch) != 0) {
+        fprintf(stderr, "Could not lock display texture: %s\n", SDL_GetError());
+        return;
+    }
+    radar_remap_gather(lookup, source, pixels, pitch, tWidth, tHeight);
+    SDL_UnlockTexture(radar->renderedTexture);
+}
+
+const char* radar_remap_mode_name(RadarDisplayMode mode) {
+    switch (mode) {
+        case RADAR_DISPLAY_PPI: return "ppi";
+        case RADAR_DISPLAY_SPHERE: return "sphere";
+        case RADAR_DISPLAY_B_SCOPE: return "bscope";
+        case RADAR_DISPLAY_SECTOR: return "sector";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef RADAR_REMAP_H
+#define RADAR_REMAP_H
+#include <SDL2/SDL.h>
+#include "radar.h"
+
+/**
+ * PPI: the scope as drawn, no remap
+ * SPHERE: the scope wrapped on a rotating UV sphere
+ * B_SCOPE: bearing horizontally (north on the left edge, clockwise), range vertically (zero at the bottom)
+ * SECTOR: a sector of the scope zoomed to fill the view, apex at the bottom center
+ */
+typedef enum {
+    RADAR_DISPLAY_PPI,
+    RADAR_DISPLAY_SPHERE,
+    RADAR_DISPLAY_B_SCOPE,
+    RADAR_DISPLAY_SECTOR,
+    RADAR_DISPLAY_COUNT
+} RadarDisplayMode;
+
+#define RADAR_SECTOR_MIN_WIDTH 5.0f
+#define RADAR_SECTOR_MAX_WIDTH 180.0f
+
+typedef struct {
+    RadarDisplayMode mode;
+    float angle_y, angle_x;  // SPHERE: spin and tilt, in degrees
+    float sectorCenter;      // SECTOR: bearing of the sector axis, in degrees like radar->angle
+    float sectorWidth;       // SECTOR: aperture in degrees, within [RADAR_SECTOR_MIN_WIDTH, RADAR_SECTOR_MAX_WIDTH]
+} RadarDisplay;
+
+const Sint32* radar_remap_lookup(Radar *radar, const RadarDisplay *display, int width, int height);
+void radar_remap_gather(const Sint32 *lookup, const Uint32 *source, void *pixels, int pitch, int width, int height);
+void radar_remap_render(Radar *radar, const RadarDisplay *display);
+const char* radar_remap_mode_name(RadarDisplayMode mode);
+
+#endif
@@ -1,6 +1,9 @@
 #include <SDL2_gfxPrimitives.h>
 #include <SDL2/SDL.h>
 #include <radar.h>
+#include "radar_remap.h"
+#include "radar_sphere.h"
+#include <math.h>
 
 
 /* Helper function to get pixel from an SDL_Surface (easier than locked texture) */
@@ -111,90 +114,57 @@ void calculate_spherical_uv_double_rotated(float point_x, float point_y, float p
 
 
 /**
- * Render radar on a sphere
- * @param radar Radar object
- * @param rotation_angle_y_degrees Angle rotation
- * @param rotation_angle_x_degrees Angle rotation
+ * Remap table of the sphere projection (see radar_remap_lookup()): for each pixel of the rendered
+ * texture, the index of the pixel to sample in the working texture or -1 outside of the sphere.
  */
-void render_uv_mapped_sphere(Radar *radar, float rotation_angle_y_degrees, float rotation_angle_x_degrees) {
-
-    SDL_Renderer* radar_renderer = radar->renderer;
-
-    if (radar->renderedTexture != NULL) {
-        SDL_DestroyTexture(radar->renderedTexture);
-        radar->renderedTexture = NULL;
-    }
-
-    // READ from Texture and copy to Surface :
-    int tWidth, tHeight;
-    SDL_QueryTexture(radar->workingTexture, NULL, NULL, &tWidth, &tHeight);
-
-    SDL_Surface* source_surface = SDL_CreateRGBSurfaceWithFormat(0, tWidth, tHeight, 32, SDL_PIXELFORMAT_RGBA8888);
-
-    SDL_SetRenderTarget(radar_renderer, radar->workingTexture);
-    SDL_RenderReadPixels(
-        radar_renderer, NULL, SDL_PIXELFORMAT_RGBA8888, source_surface->pixels, source_surface->pitch
-    );
-    SDL_SetRenderTarget(radar_renderer, NULL);
-
-    /* 1. Create a new target surface for the final sphere image */
-    /* It's easier to manipulate pixels in a Surface first, then convert to a Texture */
-    SDL_Surface* sphere_surface = SDL_CreateRGBSurfaceWithFormat(
-        0, tWidth, tHeight, 32, source_surface->format->format
-    );
-
-    if (!sphere_surface) {
-        fprintf(stderr, "Could not create sphere surface: %s\n", SDL_GetError());
-        return;
-    }
-
-    SDL_LockSurface(sphere_surface);
-
-    /* 2. Iterate over all pixels in the sphere surface */
-    for (int y = 0; y < sphere_surface->h; ++y) {
-        for (int x = 0; x < sphere_surface->w; ++x) {
+void radar_sphere_build_lookup(Sint32 *lookup, int width, int height, int radius,
+                               float rotation_angle_y_degrees, float rotation_angle_x_degrees) {
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
             /* Translate screen coords (x,y) to local surface coords relative to center */
-            float local_x = (float)x -  radar->radius;
-            float local_y = (float)y -  radar->radius;
+            float local_x = (float)x - radius;
+            float local_y = (float)y - radius;
             /* Calculate distance from a center (squared) to check if inside circle */
             float dist_sq = local_x * local_x + local_y * local_y;
 
-            if (dist_sq <=  radar->radius *  radar->radius) {
-                /* Point is inside the 2D screen projection of the sphere */
-
-                /* Now we need a 3D point on the sphere's surface that projects to this (x, y) */
+            if (dist_sq <= radius * radius) {
                 /* Use local_x, local_y, and calculate z using Pythagoras (z = sqrt(r^2 - x^2 - y^2)) */
-                float local_z = sqrtf( radar->radius *  radar->radius - dist_sq);
+                float local_z = sqrtf(radius * radius - dist_sq);
 
                 /* Map this 3D point to UV coordinates */
                 float u, v;
-                calculate_spherical_uv_double_rotated(local_x, local_y, local_z,  radar->radius,
+                calculate_spherical_uv_double_rotated(local_x, local_y, local_z, radius,
                                        0.0f, 0.0f, 0.0f, rotation_angle_y_degrees, rotation_angle_x_degrees, &u, &v);
 
-                /* Get the corresponding pixel from the source texture */
                 /* Map u, v (0.0 to 1.0) to actual pixel coordinates (0 to width/height - 1) */
-                int tex_x = (int)(u * (source_surface->w - 1));
+                int tex_x = (int)(u * (width - 1));
                 /* In SDL, V=0 is typically top, but in UV mapping V=0 is often bottom. Invert V if needed. */
-                int tex_y = (int)((1.0f - v) * (source_surface->h - 1));
-
-                Uint32 color = get_pixel_from_surface(source_surface, tex_x, tex_y);
-
-                /* Set the pixel color on our new sphere surface */
-                set_pixel_on_surface(sphere_surface, x, y, color);
+                int tex_y = (int)((1.0f - v) * (height - 1));
 
+                if (tex_x >= 0 && tex_y >= 0 && tex_x < width && tex_y < height) {
+                    lookup[y * width + x] = tex_y * width + tex_x;
+                } else {
+                    lookup[y * width + x] = -1;
+                }
             } else {
-                /* Point is outside the sphere, set to transparent or background color */
-                /* Assuming a format with alpha channel (RGBA8888) and 0 is transparent */
-                set_pixel_on_surface(sphere_surface, x, y, 0);
+                /* Point is outside the sphere, it stays transparent */
+                lookup[y * width + x] = -1;
             }
         }
     }
+}
 
-    SDL_UnlockSurface(sphere_surface);
-
-    radar->renderedTexture = SDL_CreateTextureFromSurface(radar_renderer, sphere_surface);
-    if (!radar->renderedTexture) {
-        fprintf(stderr, "Could not create sphere texture: %s\n", SDL_GetError());
-    }
-
-}
\ No newline at end of file
+/**
+ * Render radar on a sphere
+ * @param radar Radar object
+ * @param rotation_angle_y_degrees Angle rotation
+ * @param rotation_angle_x_degrees Angle rotation
+ */
+void render_uv_mapped_sphere(Radar *radar, float rotation_angle_y_degrees, float rotation_angle_x_degrees) {
+    RadarDisplay display = {
+        .mode = RADAR_DISPLAY_SPHERE,
+        .angle_y = rotation_angle_y_degrees,
+        .angle_x = rotation_angle_x_degrees
+    };
+    radar_remap_render(radar, &display);
+}
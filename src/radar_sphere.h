@@ -1,5 +1,6 @@
 #ifndef RADAR_SPHERE_H
 #define RADAR_SPHERE_H
+#include "radar.h"
 
 void calculate_spherical_uv_double_rotated(float point_x, float point_y, float point_z,
                                             float radius,
@@ -7,6 +8,8 @@ void calculate_spherical_uv_double_rotated(float point_x, float point_y, float p
                                             float rotation_angle_y_degrees, /* Y-axis rotation (Spin) */
                                             float rotation_angle_x_degrees, /* X-axis rotation (Tilt) */
                                             float *u_out, float *v_out);
+void radar_sphere_build_lookup(Sint32 *lookup, int width, int height, int radius,
+                               float rotation_angle_y_degrees, float rotation_angle_x_degrees);
 void render_uv_mapped_sphere(Radar *radar, float rotation_angle_y_degrees, float rotation_angle_x_degrees) ;
 void set_pixel_on_surface(SDL_Surface* surface, int x, int y, Uint32 pixel);
 Uint32 get_pixel_from_surface(SDL_Surface* surface, int x, int y);
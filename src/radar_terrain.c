@@ -0,0 +1,174 @@
+#include "radar_terrain.h"
+#include "radar_arena.h"
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RADAR_TERRAIN_MMAP 1
+#endif
+
+/**
+ * About one bin per pixel of the scope circumference, like the echo spokes
+ */
+static int radar_terrain_bearings(const Radar *radar) {
+    return SDL_max(64, (int) ceil(2.0 * M_PI * radar->radius));
+}
+
+/**
+ * Bytes radar_terrain_create() carves from the arena
+ */
+size_t radar_terrain_footprint(const Radar *radar) {
+    return RADAR_ARENA_FOOTPRINT(sizeof(RadarTerrain)) +
+           RADAR_ARENA_FOOTPRINT(sizeof(float) * radar_terrain_bearings(radar));
+}
+
+/**
+ * Read only view of the whole file: mapped where possible, loaded otherwise
+ */
+static const void* radar_terrain_map(const char *path, size_t *size) {
+#ifdef RADAR_TERRAIN_MMAP
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    *size = (size_t) status.st_size;
+    return data;
+#else
+    return SDL_LoadFile(path, size);
+#endif
+}
+
+static void radar_terrain_unmap(const void *data, size_t size) {
+#ifdef RADAR_TERRAIN_MMAP
+    munmap((void*) data, size);
+#else
+    (void) size;
+    SDL_free((void*) data);
+#endif
+}
+
+static inline float radar_terrain_elevation(const Sint16 *elevations, const RadarTerrainHeader *header, float u, float v) {
+    const int column = SDL_clamp((int) u, 0, (int) header->width - 1);
+    const int row = SDL_clamp((int) v, 0, (int) header->height - 1);
+    return (float) (Sint16) SDL_SwapLE16((Uint16) elevations[(size_t) row * header->width + column]);
+}
+
+/**
+ * March each bearing from the antenna out to the scope edge, keeping the steepest terrain slope seen so far:
+ * the horizon ends at the first sample where a contact standing on the ground would sit below it.
+ */
+static void radar_terrain_build_horizon(RadarTerrain *terrain, const Radar *radar, const RadarTerrainHeader *header, const Sint16 *elevations) {
+    const float radius = (float) radar->radius;
+    const float worldPerPixel = (float) radar->range_scale;
+    const float cellsPerPixelX = header->width / (2.0f * radius);
+    const float cellsPerPixelY = header->height / (2.0f * radius);
+    const float metersPerPixel = header->cellSize * cellsPerPixelX;
+    const float antenna = radar_terrain_elevation(elevations, header, header->width * 0.5f, header->height * 0.5f) + header->antennaHeight;
+
+    for (int b = 0; b < terrain->bearings; ++b) {
+        const float bearing = (b + 0.5f) / terrain->binsPerRadian;
+        const float dx = cosf(bearing);
+        const float dy = sinf(bearing);
+        float steepest = -FLT_MAX;
+        float horizon = INFINITY; // Leaving the map unblocked: nothing hides the contacts further out
+        for (float s = RADAR_TERRAIN_STEP; s <= radius; s += RADAR_TERRAIN_STEP) {
+            const float ground = radar_terrain_elevation(elevations, header,
+                (radius + s * dx) * cellsPerPixelX, (radius + s * dy) * cellsPerPixelY);
+            const float distance = s * metersPerPixel;
+            if ((ground + header->targetHeight - antenna) / distance < steepest) {
+                horizon = (s - RADAR_TERRAIN_STEP) * worldPerPixel;
+                break;
+            }
+            steepest = SDL_max(steepest, (ground - antenna) / distance);
+        }
+        terrain->horizon[b] = horizon;
+    }
+
+    // FNV-1a of the profile: radars over the same terrain share their static layer
+    terrain->hash = 2166136261u;
+    const Uint8 *bytes = (const Uint8*) terrain->horizon;
+    for (size_t i = 0; i < sizeof(float) * terrain->bearings; ++i) {
+        terrain->hash = (terrain->hash ^ bytes[i]) * 16777619u;
+    }
+}
+
+/**
+ * Load an elevation file (see RadarTerrainHeader) and reduce it to the horizon profile of the radar.
+ * The file is only mapped during the call. Returns NULL, the radar then sees everything, when it
+ * cannot be read or is not a terrain file.
+ */
+RadarTerrain* radar_terrain_create(const Radar *radar, RadarArena *arena, const char *path) {
+    size_t size = 0;
+    const void *data = radar_terrain_map(path, &size);
+    if (data == NULL) {
+        fprintf(stderr, "Could not read terrain file %s\n", path);
+        return NULL;
+    }
+
+    RadarTerrainHeader header;
+    if (size < sizeof(header)) {
+        fprintf(stderr, "Terrain file %s is truncated\n", path);
+        radar_terrain_unmap(data, size);
+        return NULL;
+    }
+    memcpy(&header, data, sizeof(header));
+    header.version = SDL_SwapLE32(header.version);
+    header.width = SDL_SwapLE32(header.width);
+    header.height = SDL_SwapLE32(header.height);
+    header.cellSize = SDL_SwapFloatLE(header.cellSize);
+    header.antennaHeight = SDL_SwapFloatLE(header.antennaHeight);
+    header.targetHeight = SDL_SwapFloatLE(header.targetHeight);
+    if (memcmp(header.magic, RADAR_TERRAIN_MAGIC, sizeof(header.magic)) != 0 || header.version != RADAR_TERRAIN_VERSION ||
+        header.width == 0 || header.height == 0 || header.cellSize <= 0.0f ||
+        size < sizeof(header) + sizeof(Sint16) * (size_t) header.width * header.height) {
+        fprintf(stderr, "%s is not a version %d terrain file\n", path, RADAR_TERRAIN_VERSION);
+        radar_terrain_unmap(data, size);
+        return NULL;
+    }
+
+    RadarTerrain *terrain = radar_arena_alloc(arena, sizeof(RadarTerrain));
+    if (terrain != NULL) {
+        terrain->bearings = radar_terrain_bearings(radar);
+        terrain->binsPerRadian = terrain->bearings / (2.0f * (float) M_PI);
+        terrain->horizon = radar_arena_alloc(arena, sizeof(float) * terrain->bearings);
+        if (terrain->horizon == NULL) {
+            terrain = NULL;
+        } else {
+            radar_terrain_build_horizon(terrain, radar, &header, (const Sint16*) ((const Uint8*) data + sizeof(header)));
+        }
+    }
+    radar_terrain_unmap(data, size);
+    return terrain;
+}
+
+/**
+ * Shadow of the masked sectors over the scope square through the current view, RGBA8888 with the pitch
+ * of the scope width, transparent where the contacts are in sight. Drawn into the static layer, again
+ * after each change of the view.
+ */
+void radar_terrain_shadow(const Radar *radar, Uint32 *pixels) {
+    const int width = radar_width(radar);
+    const int height = radar_height(radar);
+    const int center = radar->padding + radar->radius;
+    const int radiusSquared = radar->radius * radar->radius;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const int dx = x - center;
+            const int dy = y - center;
+            const bool masked = dx * dx + dy * dy <= radiusSquared && !radar_terrain_visible(radar->terrain,
+                radar->view.centerX + dx / radar->view.scale, radar->view.centerY + dy / radar->view.scale);
+            pixels[(size_t) y * width + x] = masked ? RADAR_TERRAIN_SHADOW_COLOR : 0;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef RADAR_TERRAIN_H
+#define RADAR_TERRAIN_H
+#include <SDL2/SDL.h>
+#include <math.h>
+#include "radar.h"
+
+#define RADAR_TERRAIN_MAGIC "RTER"
+#define RADAR_TERRAIN_VERSION 1
+#define RADAR_TERRAIN_STEP 0.5f                      // Ray march step in scope pixels at zoom 1
+#define RADAR_TERRAIN_SHADOW_COLOR 0x00000078u       // RGBA8888 painted over the masked sectors of the static layer
+
+/**
+ * Elevation file, little endian: this header then width x height Sint16 elevations in meters,
+ * row by row from the north edge. The map is centered on the antenna and spans the scope square at zoom 1,
+ * the radius times the range scale each way.
+ */
+typedef struct {
+    char magic[4];       // RADAR_TERRAIN_MAGIC
+    Uint32 version;      // RADAR_TERRAIN_VERSION
+    Uint32 width, height;
+    float cellSize;      // Meters per cell
+    float antennaHeight; // Meters above the ground under the antenna
+    float targetHeight;  // Meters above the ground assumed for the contacts
+    Uint32 reserved;
+} RadarTerrainHeader;
+
+/**
+ * Line of sight of the antenna over the terrain, reduced at load to the range up to which a contact
+ * stays visible on each bearing. Ridges hide everything behind them, even ground rising back into view.
+ */
+struct RadarTerrain {
+    int bearings;        // Azimuth bins over the full turn, same orientation as the contact bearings (atan2 of y, x)
+    float binsPerRadian;
+    float *horizon;      // Visible range per bin, world units, INFINITY when the terrain never blocks the bearing
+    Uint32 hash;         // Of the horizon, keys the static layer that carries the shadow
+};
+
+size_t radar_terrain_footprint(const Radar *radar);
+RadarTerrain* radar_terrain_create(const Radar *radar, RadarArena *arena, const char *path);
+void radar_terrain_shadow(const Radar *radar, Uint32 *pixels);
+
+/**
+ * Whether a contact at world (x, y) from the antenna is in sight, one table lookup.
+ * Everything is in sight without terrain.
+ */
+static inline bool radar_terrain_visible(const RadarTerrain *terrain, double x, double y) {
+    if (terrain == NULL) return true;
+    float bearing = atan2f((float) y, (float) x);
+    if (bearing < 0.0f) bearing += 2.0f * (float) M_PI;
+    int bin = (int) (bearing * terrain->binsPerRadian);
+    if (bin >= terrain->bearings) bin = 0;
+    const float range = terrain->horizon[bin];
+    return (float) x * x + (float) y * y <= range * range;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include "radar_track.h"
+#include "radar_arena.h"
+#include "radar_batch.h"
+#include "radar_object.h"
+#include "radar_raster.h"
+#include "radar_terrain.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Bytes radar_tracks_create() carves from the arena
+ */
+size_t radar_tracks_footprint(const Radar *radar) {
+    const int length = SDL_min(radar->track_length, RADAR_TRACK_MAX_LENGTH);
+    return RADAR_ARENA_FOOTPRINT(sizeof(RadarTracks)) +
+           RADAR_ARENA_FOOTPRINT(sizeof(Sint16) * 2 * radar->max_contacts * length) +
+           RADAR_ARENA_FOOTPRINT(sizeof(Uint32) * radar->max_contacts) +
+           RADAR_ARENA_FOOTPRINT(sizeof(Uint8) * radar->max_contacts);
+}
+
+/**
+ * Empty history for every slot of the contact pool. The SDL backend gets a batch of its own, the others
+ * draw the tails with the rest of the scope.
+ */
+RadarTracks* radar_tracks_create(const Radar *radar, RadarArena *arena) {
+    RadarTracks *tracks = radar_arena_alloc(arena, sizeof(RadarTracks));
+    if (tracks == NULL) return NULL;
+    *tracks = (RadarTracks){
+        .capacity = radar->max_contacts,
+        .length = SDL_min(radar->track_length, RADAR_TRACK_MAX_LENGTH),
+        .interval = radar->track_interval > 0 ? radar->track_interval : RADAR_TRACK_DEFAULT_INTERVAL,
+        .toQuantum = RADAR_TRACK_QUANTUM / radar->theater_range
+    };
+    tracks->points = radar_arena_alloc(arena, sizeof(Sint16) * 2 * tracks->capacity * tracks->length);
+    tracks->owners = radar_arena_alloc(arena, sizeof(Uint32) * tracks->capacity);
+    tracks->filled = radar_arena_alloc(arena, sizeof(Uint8) * tracks->capacity);
+    if (tracks->points == NULL || tracks->owners == NULL || tracks->filled == NULL) return NULL;
+    memset(tracks->owners, 0, sizeof(Uint32) * tracks->capacity);
+    memset(tracks->filled, 0, sizeof(Uint8) * tracks->capacity);
+
+    if (radar->backend == RADAR_BACKEND_SDL) {
+        tracks->batch = radar_batch_create();
+        if (tracks->batch == NULL) {
+            fprintf(stderr, "Could not create the track batch, tails are hidden\n");
+            return NULL;
+        }
+    }
+    return tracks;
+}
+
+/**
+ * Only the batch is owned, the history goes with the arena
+ */
+void radar_tracks_destroy(RadarTracks *tracks) {
+    if (tracks == NULL) return;
+    radar_batch_destroy(tracks->batch);
+    tracks->batch = NULL;
+}
+
+static inline Sint16 radar_track_quantize(const RadarTracks *tracks, double value) {
+    return (Sint16) SDL_clamp(lround(value * tracks->toQuantum), -32767L, 32767L);
+}
+
+/**
+ * Every interval contact updates, move the head one position on and write the position of each contact
+ * in its slot. A slot taken by a new contact since its last write starts an empty history.
+ */
+void radar_tracks_record(Radar *radar) {
+    RadarTracks *tracks = radar->tracks;
+    if (tracks == NULL || ++tracks->updates % (Uint32) tracks->interval != 0) return;
+
+    tracks->head = (tracks->head + 1) % tracks->length;
+    for (const RadarObjectLinkedList *node = radar->radar_objects; node != NULL; node = node->next) {
+        if (node->object.status == RADAR_OBJECT_STATUS_DEAD) continue;
+        const size_t slot = (size_t) (node - radar->contactPool.nodes);
+        if (tracks->owners[slot] != node->id) {
+            tracks->owners[slot] = node->id;
+            tracks->filled[slot] = 0;
+        }
+        Sint16 *point = tracks->points + 2 * (slot * tracks->length + tracks->head);
+        point[0] = radar_track_quantize(tracks, node->object.x);
+        point[1] = radar_track_quantize(tracks, node->object.y);
+        if (tracks->filled[slot] < tracks->length) {
+            tracks->filled[slot]++;
+        }
+    }
+}
+
+/**
+ * Tails of the live contacts, under them: one square dot per recorded position, fading with its age.
+ * Batched with the scope on the geometry backend, rasterized on the CPU one, and sent in a single
+ * geometry call of their own with SDL2_gfx, whatever the number of contacts.
+ */
+void radar_tracks_draw(const Radar *radar) {
+    RadarTracks *tracks = radar->tracks;
+    if (tracks == NULL) return;
+    RadarBatch *batch = radar->backend == RADAR_BACKEND_GEOMETRY ? radar->batch : tracks->batch;
+
+    const double toWorld = 1.0 / tracks->toQuantum;
+    const int radiusSquared = radar->radius * radar->radius;
+    const int centerX = RADAR_CENTER_X(radar);
+    const int centerY = RADAR_CENTER_Y(radar);
+    const float half = RADAR_TRACK_DOT / 2.0f;
+    for (const RadarObjectLinkedList *node = radar->radar_objects; node != NULL; node = node->next) {
+        if (node->object.status != RADAR_OBJECT_STATUS_ALIVE) continue;
+        const size_t slot = (size_t) (node - radar->contactPool.nodes);
+        if (tracks->owners[slot] != node->id) continue;
+        const SDL_Color color = radar_object_color(&node->object);
+        const Sint16 *ring = tracks->points + 2 * slot * tracks->length;
+
+        for (int age = 0; age < tracks->filled[slot]; ++age) {
+            const int index = (tracks->head - age + tracks->length) % tracks->length;
+            const double x = ring[2 * index] * toWorld;
+            const double y = ring[2 * index + 1] * toWorld;
+            if (fabs(x - radar->view.centerX) > radar->view.range || fabs(y - radar->view.centerY) > radar->view.range) continue;
+            int scopeX, scopeY;
+            radar_view_to_scope(radar, x, y, &scopeX, &scopeY);
+            if (scopeX * scopeX + scopeY * scopeY > radiusSquared) continue;
+            if (!radar_terrain_visible(radar->terrain, x, y)) continue;
+
+            const SDL_Color dot = {color.r, color.g, color.b, (Uint8) (RADAR_TRACK_ALPHA * (tracks->length - age) / tracks->length)};
+            if (radar->backend == RADAR_BACKEND_CPU) {
+                radar_raster_rounded_box(radar->raster, centerX + scopeX, centerY + scopeY,
+                    centerX + scopeX + (int) RADAR_TRACK_DOT - 1, centerY + scopeY + (int) RADAR_TRACK_DOT - 1, 0, RADAR_RASTER_RGBA(dot));
+            } else {
+                const float dotX = (float) (centerX + scopeX) + 0.5f;
+                const float dotY = (float) (centerY + scopeY) + 0.5f;
+                radar_batch_rect(batch, dotX - half, dotY - half, dotX + half, dotY + half, dot);
+            }
+        }
+    }
+    if (tracks->batch != NULL) {
+        radar_batch_flush(tracks->batch, radar->renderer);
+    }
+}
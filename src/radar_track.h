@@ -0,0 +1,37 @@
+#ifndef RADAR_TRACK_H
+#define RADAR_TRACK_H
+#include <SDL2/SDL.h>
+#include "radar.h"
+
+#define RADAR_TRACK_MAX_LENGTH 255       // Positions kept per contact, the fill count is a byte
+#define RADAR_TRACK_DEFAULT_INTERVAL 8   // Contact updates between two recorded positions
+#define RADAR_TRACK_DOT 2.0f             // Side of a history dot in scope pixels
+#define RADAR_TRACK_ALPHA 160            // Alpha of the newest dot, the oldest fade to nearly transparent
+#define RADAR_TRACK_QUANTUM 32767.0      // Sint16 steps over the theater range
+
+/**
+ * Last positions of every contact, for the history tails. One ring of length positions per pool slot,
+ * all rings in one block with the same head, since every contact is recorded on the same update.
+ * Positions are world coordinates quantized to Sint16 over the theater range: capacity x length x 4 bytes,
+ * plus the slot owner and fill count.
+ */
+struct RadarTracks {
+    Sint16 *points;   // [slot][ring index] x, y
+    Uint32 *owners;   // Contact id of the slot when its ring was last written, a reused slot starts over
+    Uint8 *filled;    // Valid positions of the slot, up to length
+    int capacity;     // Pool slots
+    int length;
+    int interval;
+    int head;         // Ring index of the newest positions
+    Uint32 updates;   // Contact updates seen, a position is recorded every interval
+    double toQuantum; // Sint16 steps per world unit
+    RadarBatch *batch; // SDL backend only: the tails go through one geometry call of their own
+};
+
+size_t radar_tracks_footprint(const Radar *radar);
+RadarTracks* radar_tracks_create(const Radar *radar, RadarArena *arena);
+void radar_tracks_destroy(RadarTracks *tracks);
+void radar_tracks_record(Radar *radar);
+void radar_tracks_draw(const Radar *radar);
+
+#endif